@@ -0,0 +1,407 @@
+/* bench.c - render cost and golden frames for the drawing routines
+ *
+ *   timesup_bench [-g golden.txt] [-u] [-m ms]
+ *
+ * Runs each routine over all of its inputs (every hue/saturation/value,
+ * every x/y, every glyph and angle, spiral index, score and time, every
+ * window of a scrolling text, a glyph turned and scaled in steps) and
+ * reports ns per call and pixels per second. Timing repeats the sweep for
+ * at least -m ms (default 200) and takes the best sweep. The drawing
+ * routines only write layer cells, so each call is followed by the
+ * compositor_merge() a frame would run, and its time counts too.
+ *
+ * Before timing, one sweep hashes what each call produced: the merged
+ * strip for the drawing routines, the return values for the others. The
+ * hashes are checked against the golden file (one "<size> <routine>
+ * <hash>" line each, per display size), so a faster version of a routine
+ * can be proven to draw the same pixels. -u writes the current hashes
+ * there instead. Exits 1 on a mismatch, or when a routine has no golden
+ * hash for this size.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "hal.h"
+#include "hal_host.h"
+#include "framebuffer.h"
+#include "compositor.h"
+#include "spiral.h"
+#include "text.h"
+#include "anim.h"
+#include "bitmaps_12x12.h"
+
+#ifndef TIMESUP_GOLDEN
+#define TIMESUP_GOLDEN "golden.txt"
+#endif
+
+// the game's renderer, timesup_main.c
+esp_err_t setup_glyph_strip(void);
+void setup_hud(void);
+void clear_hud(void);
+void draw_bitmap_rgb(uint16_t glyph, short int angle, short int r, short int g, short int b);
+void draw_score(int s);
+void draw_time(int t);
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+
+static const short int angles[] = { 0, 90, 180, 270, -180 };
+#define ANGLES (sizeof(angles) / sizeof(angles[0]))
+
+// keeps the compiler from dropping calls whose result isn't used
+static volatile uint32_t sink;
+
+typedef struct {
+    const char *name;
+    // one sweep over every input; with hash set, also fold what each call
+    // produced into *hash and count the pixels it lit
+    void (*sweep)(uint64_t *hash, uint64_t *pixels);
+    uint64_t calls;         // per sweep
+} routine_t;
+
+static inline uint64_t fnv(uint64_t hash, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        hash = (hash ^ (v & 0xff)) * FNV_PRIME;
+        v >>= 8;
+    }
+    return hash;
+}
+
+// merge into the strip as a frame does, part of the timed cost; with
+// hash set also fold the strip, as GRB whatever the buffer format
+static void present(uint64_t *hash, uint64_t *pixels)
+{
+    compositor_merge();
+    if (!hash) {
+        return;
+    }
+    for (uint32_t i = 0; i < STRIP_LENGTH; i++) {
+#if FRAMEBUFFER_INDEXED
+        const uint8_t *p = &framebuffer_palette[led_strip_pixels[i] * 3];
+#else
+        const uint8_t *p = &led_strip_pixels[i * 3];
+#endif
+        uint32_t grb = p[0] << 16 | p[1] << 8 | p[2];
+        *hash = fnv(*hash, grb);
+        *pixels += grb != 0;
+    }
+}
+
+static void sweep_hsv2rgb(uint64_t *hash, uint64_t *pixels)
+{
+    uint32_t r, g, b;
+    for (uint32_t h = 0; h < 360; h++) {
+        for (uint32_t s = 0; s <= 100; s++) {
+            for (uint32_t v = 0; v <= 100; v++) {
+                hsv2rgb(h, s, v, &r, &g, &b);
+                if (hash) {
+                    *hash = fnv(*hash, r << 16 | g << 8 | b);
+                    (*pixels)++;
+                }
+                else {
+                    sink = r + g + b;
+                }
+            }
+        }
+    }
+}
+
+static void sweep_xy_to_strip(uint64_t *hash, uint64_t *pixels)
+{
+    uint32_t sum = 0;
+    for (uint32_t x = 0; x < SIZE_X; x++) {
+        for (uint32_t y = 0; y < SIZE_Y; y++) {
+            uint32_t index = xy_to_strip(x, y);
+            if (hash) {
+                *hash = fnv(*hash, index);
+                (*pixels)++;
+            }
+            sum += index;
+        }
+    }
+    sink = sum;
+}
+
+static void sweep_setup_spiral(uint64_t *hash, uint64_t *pixels)
+{
+    setup_spiral();
+    if (hash) {
+        // the order is all it makes, so draw it whole
+        draw_spiral(STRIP_LENGTH - 1);
+        present(hash, pixels);
+        spiral_reset();
+    }
+}
+
+static void sweep_draw_spiral(uint64_t *hash, uint64_t *pixels)
+{
+    for (uint32_t i = 0; i < STRIP_LENGTH; i++) {
+        spiral_reset();
+        draw_spiral(i);
+        present(hash, pixels);
+    }
+    spiral_reset();
+}
+
+static void sweep_draw_bitmap_rgb(uint64_t *hash, uint64_t *pixels)
+{
+    for (uint32_t glyph = 0; glyph < BITMAPS_12X12_COUNT; glyph++) {
+        for (uint32_t a = 0; a < ANGLES; a++) {
+            draw_bitmap_rgb(glyph, angles[a], 1, 1, 1);
+            present(hash, pixels);
+        }
+    }
+    layer_clear(LAYER_GLYPH);
+}
+
+static void sweep_draw_score(uint64_t *hash, uint64_t *pixels)
+{
+    for (int s = 0; s <= 999; s++) {
+        draw_score(s);
+        present(hash, pixels);
+    }
+    clear_hud();
+}
+
+// a score that doesn't change, what most frames of a round see
+static void sweep_draw_score_same(uint64_t *hash, uint64_t *pixels)
+{
+    for (int i = 0; i < 1000; i++) {
+        draw_score(42);
+        present(NULL, NULL);
+    }
+    present(hash, pixels);
+    clear_hud();
+}
+
+static void sweep_draw_time(uint64_t *hash, uint64_t *pixels)
+{
+    for (int t = 0; t <= 9999; t++) {
+        draw_time(t);
+        present(hash, pixels);
+    }
+    clear_hud();
+}
+
+static const char bench_text[] = "SCORE 12 - BEST 234MS!";
+
+static void sweep_text_rasterize(uint64_t *hash, uint64_t *pixels)
+{
+    uint16_t columns[TEXT_MAX_COLUMNS];
+    for (text_font_t font = TEXT_FONT_4X6; font <= TEXT_FONT_5X6; font++) {
+        int n = text_rasterize(bench_text, font, columns, TEXT_MAX_COLUMNS);
+        if (hash) {
+            for (int i = 0; i < n; i++) {
+                *hash = fnv(*hash, columns[i]);
+                *pixels += __builtin_popcount(columns[i]);
+            }
+        }
+        else {
+            sink = columns[n - 1];
+        }
+    }
+}
+
+// one marquee_update() per column the text moves, a whole loop
+static void sweep_marquee_update(uint64_t *hash, uint64_t *pixels)
+{
+    static marquee_t m;
+    // a column per us, so t is the window
+    marquee_init(&m, LAYER_HUD, 0, 0, 16, 2, 2, 2, 1000000);
+    marquee_set_text(&m, bench_text, TEXT_FONT_4X6, 0);
+    for (int64_t t = 0; t < m.period; t++) {
+        marquee_update(&m, t);
+        present(hash, pixels);
+    }
+    layer_clear(LAYER_HUD);
+}
+
+#define ANIM_ANGLES 72
+#define ANIM_SCALES 3
+// display pixels per glyph pixel, as the game draws them
+#define ANIM_GLYPH_SCALE ((SIZE_X < SIZE_Y ? SIZE_X : SIZE_Y) / 16)
+
+// the X turned all the way round in 5 degree steps, at three sizes
+static void sweep_anim_sprite_draw(uint64_t *hash, uint64_t *pixels)
+{
+    static anim_sprite_t sprite;
+    anim_sprite_init(&sprite, LAYER_GLYPH, ANIM_GLYPH_SCALE);
+    anim_pose_t pose = anim_rest;
+    for (int k = 0; k < ANIM_SCALES; k++) {
+        pose.value[ANIM_SCALE] = ANIM_ONE / 2 * (k + 1);
+        for (int a = 0; a < ANIM_ANGLES; a++) {
+            pose.value[ANIM_ANGLE] = ANIM_DEG(a * 360 / ANIM_ANGLES);
+            anim_sprite_draw(&sprite, bitmaps_12x12[BITMAPS_12X12_X][GLYPH_ROT_0],
+                             BITMAPS_12X12_WIDTH, BITMAPS_12X12_HEIGHT, &pose, 1, 1, 1);
+            present(hash, pixels);
+        }
+    }
+    layer_clear(LAYER_GLYPH);
+}
+
+static routine_t routines[] = {
+    { "hsv2rgb",         sweep_hsv2rgb,         360 * 101 * 101 },
+    { "xy_to_strip",     sweep_xy_to_strip,     SIZE_X * SIZE_Y },
+    { "setup_spiral",    sweep_setup_spiral,    1 },
+    { "draw_spiral",     sweep_draw_spiral,     STRIP_LENGTH },
+    { "draw_bitmap_rgb", sweep_draw_bitmap_rgb, BITMAPS_12X12_COUNT * ANGLES },
+    { "draw_score",      sweep_draw_score,      1000 },
+    { "draw_score_same", sweep_draw_score_same, 1000 },
+    { "draw_time",       sweep_draw_time,       10000 },
+    { "text_rasterize",  sweep_text_rasterize,  2 },
+    { "marquee_update",  sweep_marquee_update,  0 },   // set in main()
+    { "anim_sprite_draw", sweep_anim_sprite_draw, ANIM_ANGLES * ANIM_SCALES },
+};
+#define ROUTINES (sizeof(routines) / sizeof(routines[0]))
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// the golden hash of routine for this display size, 0 if there is none
+static uint64_t golden_hash(const char *path, const char *size, const char *routine)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return 0;
+    }
+    char line[128], s[32], r[64];
+    unsigned long long hash;
+    uint64_t found = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%31s %63s %llx", s, r, &hash) == 3 &&
+            strcmp(s, size) == 0 && strcmp(r, routine) == 0) {
+            found = hash;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+// replace this size's lines in the golden file, keep the other sizes
+static int write_golden(const char *path, const char *size, const uint64_t *hashes)
+{
+    char *keep = NULL;
+    size_t keep_len = 0;
+    FILE *f = fopen(path, "r");
+    if (f) {
+        char line[128], s[32];
+        FILE *mem = open_memstream(&keep, &keep_len);
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "%31s", s) != 1 || strcmp(s, size) != 0) {
+                fputs(line, mem);
+            }
+        }
+        fclose(mem);
+        fclose(f);
+    }
+    f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        free(keep);
+        return -1;
+    }
+    if (keep) {
+        fwrite(keep, 1, keep_len, f);
+    }
+    for (size_t i = 0; i < ROUTINES; i++) {
+        fprintf(f, "%s %s %016llx\n", size, routines[i].name, (unsigned long long) hashes[i]);
+    }
+    free(keep);
+    return fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+    const char *golden = TIMESUP_GOLDEN;
+    int update = 0;
+    int64_t min_ms = 200;
+    int opt;
+    while ((opt = getopt(argc, argv, "g:um:h")) != -1) {
+        switch (opt) {
+        case 'g':
+            golden = optarg;
+            break;
+        case 'u':
+            update = 1;
+            break;
+        case 'm':
+            min_ms = atoll(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-g golden.txt] [-u] [-m ms]\n", argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    hal_host_set_quiet(1);
+    framebuffer_setup();
+    compositor_setup();
+    setup_spiral();
+    ESP_ERROR_CHECK(setup_glyph_strip());
+    setup_hud();
+
+    for (size_t i = 0; i < ROUTINES; i++) {
+        if (routines[i].sweep == sweep_marquee_update) {
+            // one scrolling loop of the bench text
+            routines[i].calls = text_width(bench_text, TEXT_FONT_4X6) + MARQUEE_GAP;
+        }
+    }
+
+    char size[32];
+    snprintf(size, sizeof(size), "%dx%d", SIZE_X, SIZE_Y);
+    uint64_t hashes[ROUTINES];
+    int failed = 0;
+    printf("%-16s %12s %14s %18s  %s\n", "routine", "calls", "ns/call", "pixels/s", "golden");
+    for (size_t i = 0; i < ROUTINES; i++) {
+        const routine_t *rt = &routines[i];
+        uint64_t hash = FNV_OFFSET;
+        uint64_t pixels = 0;
+        rt->sweep(&hash, &pixels);
+        hashes[i] = hash;
+
+        int64_t best = INT64_MAX;
+        int64_t spent = 0;
+        do {
+            int64_t start = now_ns();
+            rt->sweep(NULL, NULL);
+            int64_t t = now_ns() - start;
+            if (t < best) {
+                best = t;
+            }
+            spent += t;
+        } while (spent < min_ms * 1000000);
+        if (best < 1) {
+            best = 1;
+        }
+
+        const char *verdict;
+        uint64_t want = golden_hash(golden, size, rt->name);
+        if (update) {
+            verdict = "updated";
+        }
+        else if (want == 0) {
+            // nothing to compare against proves nothing
+            verdict = "MISSING";
+            failed = 1;
+        }
+        else if (want == hash) {
+            verdict = "ok";
+        }
+        else {
+            verdict = "MISMATCH";
+            failed = 1;
+        }
+        printf("%-16s %12llu %14.1f %18.0f  %s\n", rt->name, (unsigned long long) rt->calls,
+               (double) best / rt->calls, pixels * 1e9 / best, verdict);
+    }
+    if (update && write_golden(golden, size, hashes) != 0) {
+        return 1;
+    }
+    return failed;
+}
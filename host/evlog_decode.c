@@ -0,0 +1,80 @@
+/* evlog_decode.c - turn "@EV" lines from evlog back into log text
+ *
+ *   idf.py monitor | timesup_evlog
+ *   timesup_evlog capture.txt...
+ *   timesup_evlog -w session.trace capture.txt
+ *
+ * Lines that aren't records are copied through as they are. -w also
+ * collects the session trace (trace.h) the records hold, for
+ * timesup_host -p.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "evlog.h"
+#include "trace.h"
+
+static FILE *trace_out = NULL;
+static int64_t trace_last_us = 0;
+
+static void decode(FILE *in)
+{
+    char line[512];
+    char text[256];
+    evlog_record_t r;
+    trace_event_t e;
+    while (fgets(line, sizeof(line), in)) {
+        if (evlog_decode(line, &r) && evlog_format(&r, text, sizeof(text)) >= 0) {
+            puts(text);
+            if (r.id == EV_DROPPED) {
+                fprintf(stderr, "warning: records were dropped, a trace may not replay\n");
+            }
+            if (trace_out && trace_from_record(&r, &e)) {
+                trace_write(trace_out, &e, &trace_last_us);
+            }
+        }
+        else {
+            fputs(line, stdout);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "w:h")) != -1) {
+        switch (opt) {
+        case 'w':
+            trace_out = fopen(optarg, "wb");
+            if (!trace_out || !trace_write_header(trace_out)) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-w session.trace] [capture...]\n", argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    int ret = 0;
+    if (optind == argc) {
+        decode(stdin);
+    }
+    for (int i = optind; i < argc && ret == 0; i++) {
+        FILE *in = strcmp(argv[i], "-") == 0 ? stdin : fopen(argv[i], "r");
+        if (!in) {
+            perror(argv[i]);
+            ret = 1;
+            break;
+        }
+        decode(in);
+        if (in != stdin) {
+            fclose(in);
+        }
+    }
+    if (trace_out && fclose(trace_out) != 0) {
+        perror("trace");
+        ret = 1;
+    }
+    return ret;
+}
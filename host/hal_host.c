@@ -0,0 +1,477 @@
+/* hal_host.c - hal.h on Linux
+ *
+ * Virtual clock, scripted GPIO presses and fake RMT channels that record
+ * frames. Everything runs on the caller's thread, so a session is fully
+ * deterministic for a given script and seed. Transmits are asynchronous
+ * like on the board: a frame goes on the wire when the one before it is
+ * done, and only hal_led_wait_frame() (or a full queue) moves the clock.
+ * With several channels each sends its run of the frame, all starting
+ * together once every channel is free, and the frame is done when the
+ * slowest is.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "esp_log.h"
+#include "hal.h"
+#include "hal_host.h"
+#include "trace.h"
+
+// WS2812 timing from led_strip_encoder.c: 1.2us per bit plus a 50us reset
+#define WIRE_NS_PER_BIT 1200
+#define WIRE_RESET_US   50
+// frames that can be pending, like trans_queue_depth in hal_esp.c
+#define TX_QUEUE_DEPTH  4
+
+static const char *TAG = "hal_host";
+
+typedef struct {
+    int64_t at_us;
+    uint32_t gpio_num;
+} host_press_t;
+
+static int64_t now_us = 0;
+static int64_t run_until_us = 60 * 1000000LL;
+static uint32_t rng_state = 0x7153u;
+// hal_random() results from a replayed trace, handed out before rng_state
+static uint32_t *replay_random = NULL;
+static size_t replay_random_count = 0;
+static size_t replay_random_next = 0;
+static int quiet = 0;
+
+static host_press_t *presses = NULL;
+static size_t press_count = 0;
+static size_t press_next = 0;
+static hal_input_handler_t input_handler = NULL;
+static void (*background_work)(void) = NULL;
+static input_ring_t input_ring;
+static input_filter_t input_filter;
+// the handler ran since the last hal_wait_input_until_us()
+static bool input_pending = false;
+
+static uint32_t frames_queued = 0;
+static uint32_t frames_done = 0;
+// when each of the last frames is (or will be) off the wire
+static int64_t frame_done_at[HAL_LED_FRAME_HISTORY];
+
+static hal_led_config_t led_config;
+static size_t segment_first[HAL_LED_MAX_CHANNELS];
+static size_t segment_count[HAL_LED_MAX_CHANNELS];
+// when each channel is done with its last run
+static int64_t channel_free_at[HAL_LED_MAX_CHANNELS];
+
+static uint8_t *expanded = NULL;
+static size_t expanded_size = 0;
+static FILE *frame_out = NULL;
+static uint8_t *last_frame = NULL;
+static size_t last_frame_size = 0;
+static host_led_stats_t stats = { .hash = 0xcbf29ce484222325ULL };
+
+int host_log_enabled(void)
+{
+    return !quiet;
+}
+
+long long host_log_time_ms(void)
+{
+    return now_us / 1000;
+}
+
+static inline int64_t done_at(uint32_t frame)
+{
+    return frame_done_at[frame % HAL_LED_FRAME_HISTORY];
+}
+
+// move the virtual clock forward, completing frames and delivering any
+// presses on the way, in time order. With stop_on_input the clock stops at
+// the first press the handler gets.
+static void advance_to(int64_t t, bool stop_on_input)
+{
+    for (;;) {
+        if (stop_on_input && input_pending) {
+            return;
+        }
+        int64_t press_at = press_next < press_count ? presses[press_next].at_us : INT64_MAX;
+        int64_t frame_at = frames_done != frames_queued ? done_at(frames_done + 1) : INT64_MAX;
+        if (frame_at <= press_at && frame_at <= t) {
+            if (frame_at > now_us) {
+                now_us = frame_at;
+            }
+            frames_done++;
+        }
+        else if (press_at <= t) {
+            host_press_t *p = &presses[press_next++];
+            if (p->at_us > now_us) {
+                now_us = p->at_us;
+            }
+            stats.presses++;
+            // the board's ISR, then its input task
+            input_event_t event = {
+                .gpio_num = p->gpio_num,
+                .edge = INPUT_EDGE_FALLING,
+                .at_us = now_us,
+            };
+            if (input_filter_accept(&input_filter, event.gpio_num, event.at_us)) {
+                input_ring_push(&input_ring, &input_filter.stats, &event);
+            }
+            while (input_handler && input_ring_pop(&input_ring, &event)) {
+                input_handler(&event);
+                input_pending = true;
+            }
+        }
+        else {
+            break;
+        }
+    }
+    if (t > now_us) {
+        now_us = t;
+    }
+}
+
+static int parse_button(const char *name, uint32_t *gpio_num)
+{
+    static const struct { const char *name; uint32_t gpio_num; } buttons[] = {
+        { "up", GPIO_UP }, { "down", GPIO_DOWN },
+        { "left", GPIO_LEFT }, { "right", GPIO_RIGHT },
+    };
+    for (size_t i = 0; i < sizeof(buttons) / sizeof(buttons[0]); i++) {
+        if (strcasecmp(name, buttons[i].name) == 0) {
+            *gpio_num = buttons[i].gpio_num;
+            return 0;
+        }
+    }
+    char *end;
+    unsigned long n = strtoul(name, &end, 10);
+    if (*name == '\0' || *end != '\0') {
+        return -1;
+    }
+    *gpio_num = n;
+    return 0;
+}
+
+static int add_press(int64_t at_us, uint32_t gpio_num)
+{
+    host_press_t *grown = realloc(presses, (press_count + 1) * sizeof(*presses));
+    if (!grown) {
+        return -1;
+    }
+    presses = grown;
+    presses[press_count].at_us = at_us;
+    presses[press_count].gpio_num = gpio_num;
+    press_count++;
+    return 0;
+}
+
+int hal_host_load_script(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    char line[128];
+    int lineno = 0;
+    int64_t at_ms = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        char when[32], button[32];
+        int fields = sscanf(line, "%31s %31s", when, button);
+        if (fields <= 0) {
+            continue;
+        }
+        uint32_t gpio_num;
+        if (fields != 2 || parse_button(button, &gpio_num) != 0) {
+            fprintf(stderr, "%s:%d: expected \"<ms> <button>\"\n", path, lineno);
+            fclose(f);
+            return -1;
+        }
+        if (when[0] == '+') {
+            at_ms += atoll(when + 1);
+        } else {
+            at_ms = atoll(when);
+        }
+        if (add_press(at_ms * 1000, gpio_num) != 0) {
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+int hal_host_load_trace(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    if (!trace_read_header(f)) {
+        fprintf(stderr, "%s: not a session trace\n", path);
+        fclose(f);
+        return -1;
+    }
+    trace_event_t e;
+    int64_t last_us = 0;
+    int ret = 0;
+    while (ret == 0 && trace_read(f, &e, &last_us)) {
+        if (e.kind == TRACE_INPUT) {
+            // the press as the ISR saw it, it goes through the filter again
+            ret = add_press(e.at_us, e.value);
+        }
+        else if (e.kind == TRACE_RANDOM) {
+            uint32_t *grown = realloc(replay_random, (replay_random_count + 1) * sizeof(*replay_random));
+            if (!grown) {
+                ret = -1;
+                break;
+            }
+            replay_random = grown;
+            replay_random[replay_random_count++] = e.value;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+
+void hal_host_set_seed(uint32_t seed)
+{
+    rng_state = seed ? seed : 1;
+}
+
+void hal_host_set_duration_ms(int64_t ms)
+{
+    run_until_us = ms * 1000;
+}
+
+void hal_host_record_frames(FILE *out)
+{
+    frame_out = out;
+}
+
+void hal_host_set_quiet(int q)
+{
+    quiet = q;
+}
+
+const host_led_stats_t *hal_host_stats(void)
+{
+    return &stats;
+}
+
+esp_err_t hal_led_init(const hal_led_config_t *config)
+{
+    if (config->channels < 1 || config->channels > HAL_LED_MAX_CHANNELS) {
+        ESP_LOGE(TAG, "%d LED channels, at most %d", (int) config->channels, HAL_LED_MAX_CHANNELS);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    // the runs must cover the strip, in order, without gaps or overlap
+    size_t next = 0;
+    for (uint32_t k = 0; k < config->channels; k++) {
+        hal_led_segment(config->pixels, config->channels, k, &segment_first[k], &segment_count[k]);
+        if (segment_first[k] != next || segment_count[k] == 0) {
+            ESP_LOGE(TAG, "channel %d run %d+%d, expected it at %d", (int) k,
+                     (int) segment_first[k], (int) segment_count[k], (int) next);
+            return ESP_ERR_INVALID_ARG;
+        }
+        next += segment_count[k];
+        channel_free_at[k] = 0;
+    }
+    if (next != config->pixels) {
+        ESP_LOGE(TAG, "channels cover %d of %d pixels", (int) next, (int) config->pixels);
+        return ESP_ERR_INVALID_ARG;
+    }
+    led_config = *config;
+    stats.channels = config->channels;
+    ESP_LOGI(TAG, "%d fake RMT channel(s), %d pixels each, recording %s frames",
+             (int) config->channels, (int) segment_count[0], config->indexed ? "indexed" : "GRB");
+    return ESP_OK;
+}
+
+// WS2812 time for bytes of GRB plus the reset
+static inline int64_t wire_time_us(size_t bytes)
+{
+    return (int64_t) bytes * 8 * WIRE_NS_PER_BIT / 1000 + WIRE_RESET_US;
+}
+
+esp_err_t hal_led_transmit(const uint8_t *data, size_t data_size, uint32_t *frame)
+{
+    // what goes on the wire: an indexed frame is expanded like the encoder
+    // does, so hashes and recordings don't depend on the buffer format
+    const uint8_t *pixels = data;
+    size_t size = data_size;
+    if (data_size != (led_config.indexed ? HAL_LED_PALETTE_BYTES + led_config.pixels : led_config.pixels * 3)) {
+        // like hal_esp.c, the frame must be the strip
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (led_config.indexed) {
+        size = (data_size - HAL_LED_PALETTE_BYTES) * 3;
+        if (size > expanded_size) {
+            uint8_t *grown = realloc(expanded, size);
+            if (!grown) {
+                return ESP_ERR_NO_MEM;
+            }
+            expanded = grown;
+            expanded_size = size;
+        }
+        const uint8_t *index = data + HAL_LED_PALETTE_BYTES;
+        for (size_t i = 0; i < size / 3; i++) {
+            memcpy(&expanded[i * 3], &data[index[i] * 3], 3);
+        }
+        pixels = expanded;
+    }
+    if (frames_queued - frames_done == TX_QUEUE_DEPTH) {
+        // queue full, rmt_transmit() would block
+        advance_to(done_at(frames_done + 1), false);
+    }
+    if (size != last_frame_size) {
+        uint8_t *grown = realloc(last_frame, size);
+        if (!grown) {
+            return ESP_ERR_NO_MEM;
+        }
+        last_frame = grown;
+        last_frame_size = 0;
+    }
+    if (last_frame_size == size && memcmp(last_frame, pixels, size) == 0) {
+        stats.repeated_frames++;
+    }
+    memcpy(last_frame, pixels, size);
+    last_frame_size = size;
+
+    for (size_t i = 0; i < size; i++) {
+        stats.hash = (stats.hash ^ pixels[i]) * 0x100000001b3ULL;
+    }
+    stats.frames++;
+
+    // the runs start together once every channel is done with the frame
+    // before, like the RMT sync manager does
+    int64_t start = now_us;
+    for (uint32_t k = 0; k < led_config.channels; k++) {
+        if (channel_free_at[k] > start) {
+            start = channel_free_at[k];
+        }
+    }
+    int64_t first_done = INT64_MAX;
+    int64_t done = start;
+    for (uint32_t k = 0; k < led_config.channels; k++) {
+        channel_free_at[k] = start + wire_time_us(segment_count[k] * 3);
+        if (channel_free_at[k] < first_done) {
+            first_done = channel_free_at[k];
+        }
+        if (channel_free_at[k] > done) {
+            done = channel_free_at[k];
+        }
+    }
+    if (done - first_done > stats.max_skew_us) {
+        stats.max_skew_us = done - first_done;
+    }
+    stats.wire_us += done - start;
+    *frame = ++frames_queued;
+    frame_done_at[*frame % HAL_LED_FRAME_HISTORY] = done;
+
+    if (frame_out) {
+        uint32_t len = size;
+        fwrite(&start, sizeof(start), 1, frame_out);
+        fwrite(&len, sizeof(len), 1, frame_out);
+        fwrite(pixels, 1, size, frame_out);
+    }
+    return ESP_OK;
+}
+
+esp_err_t hal_led_wait_frame(uint32_t frame)
+{
+    if ((int32_t) (frames_done - frame) < 0) {
+        advance_to(done_at(frame), false);
+    }
+    return ESP_OK;
+}
+
+int64_t hal_led_frame_done_us(uint32_t frame)
+{
+    uint32_t age = frames_done - frame;
+    if ((int32_t) age < 0 || age >= HAL_LED_FRAME_HISTORY - 1) {
+        return 0;
+    }
+    return done_at(frame);
+}
+
+esp_err_t hal_input_init(const uint32_t *pins, size_t count, hal_input_handler_t handler)
+{
+    // presses come from the script, not from pins
+    (void) pins;
+    (void) count;
+    ESP_LOGI(TAG, "scripted GPIO input, %d presses queued", (int) press_count);
+    input_handler = handler;
+    input_filter_init(&input_filter);
+    return ESP_OK;
+}
+
+void hal_input_arm(bool armed)
+{
+    input_filter.armed = armed;
+}
+
+void hal_input_set_debounce_us(uint32_t gpio_num, uint32_t us)
+{
+    if (gpio_num < INPUT_MAX_GPIO) {
+        input_filter.debounce_us[gpio_num] = us;
+    }
+}
+
+const input_stats_t *hal_input_stats(void)
+{
+    return &input_filter.stats;
+}
+
+int64_t hal_time_us(void)
+{
+    return now_us;
+}
+
+// the board's background task gets to run whenever the game sleeps
+static void run_background(void)
+{
+    if (background_work) {
+        background_work();
+    }
+}
+
+bool hal_wait_input_until_us(int64_t t)
+{
+    // nothing happens after the end of the run, don't sleep past it
+    if (t > run_until_us) {
+        t = run_until_us;
+    }
+    run_background();
+    advance_to(t, true);
+    bool input = input_pending;
+    input_pending = false;
+    return input;
+}
+
+// xorshift32, stands in for esp_random(), after any replayed numbers
+uint32_t hal_random(void)
+{
+    if (replay_random_next < replay_random_count) {
+        return replay_random[replay_random_next++];
+    }
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+esp_err_t hal_start_background(void (*work)(void))
+{
+    background_work = work;
+    return ESP_OK;
+}
+
+int hal_running(void)
+{
+    return now_us < run_until_us;
+}
@@ -0,0 +1,35 @@
+/* hal_host.h - knobs for the Linux stand-ins behind hal.h
+ *
+ * The host HAL runs on a virtual clock: hal_wait_input_until_us() and
+ * waiting on the wire (hal_led_wait_frame(), or hal_led_transmit() with
+ * the queue full) advance it instead of sleeping, so a session runs as
+ * fast as the CPU allows. Button presses come from a script, frames go to a recorder.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+    uint64_t frames;          // hal_led_transmit() calls
+    uint64_t repeated_frames; // frames identical to the one before
+    int64_t wire_us;          // virtual time spent on the wire
+    uint32_t channels;        // LED outputs sending in parallel
+    int64_t max_skew_us;      // most a frame's runs finished apart
+    uint64_t hash;            // FNV-1a over every frame sent
+    uint64_t presses;         // scripted presses delivered
+} host_led_stats_t;
+
+// load "<ms> <button>" lines, ms may be "+ms" relative to the line before
+int hal_host_load_script(const char *path);
+// replay a session trace (trace.h): its presses like a script, its random
+// numbers from hal_random() before the seeded ones
+int hal_host_load_trace(const char *path);
+void hal_host_set_seed(uint32_t seed);
+// hal_running() goes to 0 once the virtual clock passes this
+void hal_host_set_duration_ms(int64_t ms);
+// write every frame as {int64 time_us, uint32 size, pixels} records,
+// time_us being when the frame starts going out on the wire
+void hal_host_record_frames(FILE *out);
+void hal_host_set_quiet(int quiet);
+const host_led_stats_t *hal_host_stats(void);
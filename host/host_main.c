@@ -0,0 +1,126 @@
+/* host_main.c - run app_main() on Linux against the host HAL
+ *
+ *   timesup_host [-s script | -p session.trace] [-t ms] [-r seed] [-o frames.bin] [-e events.txt] [-q]
+ *
+ * The session runs on a virtual clock for -t ms (default 60000) and then
+ * prints a summary. -p replays a session trace (see trace.h) instead of a
+ * script. evlog records show up in the log as text, or go to -e
+ * encoded like on the board's console, for timesup_evlog. The frame hash
+ * only depends on the script and seed, so it can be compared between
+ * builds.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "hal.h"
+#include "hal_host.h"
+#include "frame_sched.h"
+#include "reaction_stats.h"
+#include "evlog.h"
+
+void app_main(void);
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-s script | -p session.trace] [-t ms] [-r seed] [-o frames.bin] [-e events.txt] [-q]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *frames = NULL;
+    FILE *events = NULL;
+    int quiet = 0;
+    int64_t duration_ms = 60000;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:p:t:r:o:e:qh")) != -1) {
+        switch (opt) {
+        case 's':
+            if (hal_host_load_script(optarg) != 0) {
+                return 1;
+            }
+            break;
+        case 'p':
+            if (hal_host_load_trace(optarg) != 0) {
+                return 1;
+            }
+            break;
+        case 't':
+            duration_ms = atoll(optarg);
+            break;
+        case 'r':
+            hal_host_set_seed(strtoul(optarg, NULL, 0));
+            break;
+        case 'o':
+            frames = fopen(optarg, "wb");
+            if (!frames) {
+                perror(optarg);
+                return 1;
+            }
+            hal_host_record_frames(frames);
+            break;
+        case 'e':
+            events = fopen(optarg, "w");
+            if (!events) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        case 'q':
+            hal_host_set_quiet(1);
+            quiet = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    hal_host_set_duration_ms(duration_ms);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (events) {
+        evlog_set_output(events, false);
+    } else {
+        evlog_set_output(quiet ? NULL : stderr, true);
+    }
+    app_main();
+    evlog_drain();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (frames) {
+        fclose(frames);
+    }
+    if (events) {
+        fclose(events);
+    }
+
+    const host_led_stats_t *stats = hal_host_stats();
+    double wall_ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    printf("virtual time  %lld ms\n", (long long) (hal_time_us() / 1000));
+    printf("wall time     %.3f ms (%.0fx real time)\n", wall_ms,
+           wall_ms > 0 ? hal_time_us() / 1000.0 / wall_ms : 0.0);
+    printf("frames        %llu (%llu repeated)\n",
+           (unsigned long long) stats->frames, (unsigned long long) stats->repeated_frames);
+    printf("wire time     %lld ms on %u channel(s), runs up to %lld us apart\n",
+           (long long) (stats->wire_us / 1000), (unsigned) stats->channels, (long long) stats->max_skew_us);
+    const input_stats_t *input = hal_input_stats();
+    printf("presses       %llu (%u accepted, %u bounced, %u while disarmed, %u overflowed)\n",
+           (unsigned long long) stats->presses, (unsigned) input->accepted, (unsigned) input->bounced,
+           (unsigned) input->disarmed, (unsigned) input->overflowed);
+    printf("frame hash    %016llx\n", (unsigned long long) stats->hash);
+    uint32_t n = frame_stats.frames ? frame_stats.frames : 1;
+    printf("loop frames   %u at up to %u fps, %u missed, %u woken by input\n",
+           (unsigned) frame_stats.frames, (unsigned) frame_stats.fps, (unsigned) frame_stats.missed,
+           (unsigned) frame_stats.input_wakes);
+    printf("frame time    render %lld us, transmit %lld us, idle %lld us (avg)\n",
+           (long long) (frame_stats.render_us_total / n),
+           (long long) (frame_stats.transmit_us_total / n),
+           (long long) (frame_stats.idle_us_total / n));
+    const reaction_hist_t *reactions = &reaction_lifetime.split[REACTION_ALL];
+    printf("reactions     %u correct, %u wrong, p50 %lld us, p90 %lld us, p99 %lld us\n",
+           (unsigned) reactions->count, (unsigned) reactions->wrong,
+           (long long) reaction_percentile_us(reactions, 50),
+           (long long) reaction_percentile_us(reactions, 90),
+           (long long) reaction_percentile_us(reactions, 99));
+    return 0;
+}
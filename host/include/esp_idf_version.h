@@ -0,0 +1,7 @@
+/* esp_idf_version.h - host stand-in, claims the IDF release whose RMT
+ * encoder API host/rmt_sim.c follows (simple encoder included)
+ */
+#pragma once
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(5, 3, 0)
@@ -0,0 +1,24 @@
+/* esp_log.h - host stand-in, log lines go to stderr
+ *
+ * timesup_host -q drops them when profiling.
+ */
+#pragma once
+
+#include <stdio.h>
+#include "esp_err.h"
+
+int host_log_enabled(void);
+// virtual clock in ms, like the board's log timestamp
+long long host_log_time_ms(void);
+
+#define HOST_LOG(level, tag, format, ...) do {                          \
+        if (host_log_enabled()) {                                       \
+            fprintf(stderr, level " (%lld) %s: " format "\n",           \
+                    host_log_time_ms(), tag, ##__VA_ARGS__);            \
+        }                                                               \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) do { (void) (tag); } while (0)
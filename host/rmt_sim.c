@@ -0,0 +1,352 @@
+/* rmt_sim.c - RMT encoders and a simulated TX channel, see rmt_sim.h
+ *
+ * The encoders follow the IDF ones where it matters to the callers: they
+ * write as much as fits, report RMT_ENCODING_MEM_FULL when they run out of
+ * room and carry on from there on the next call, and report
+ * RMT_ENCODING_COMPLETE once all of their data is out. The simple encoder
+ * hands its callback at least min_chunk_size free symbols, going through
+ * an overflow buffer when the block has less room left than that.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "rmt_sim.h"
+
+// room left in the current fill
+static inline size_t mem_free(const struct rmt_channel_t *chan)
+{
+    return chan->end - chan->off;
+}
+
+// of which this much is in one piece before the ring wraps
+static inline size_t mem_free_contiguous(const struct rmt_channel_t *chan)
+{
+    size_t to_wrap = chan->mem_symbols - chan->off % chan->mem_symbols;
+    size_t free = mem_free(chan);
+    return free < to_wrap ? free : to_wrap;
+}
+
+static inline void mem_put(struct rmt_channel_t *chan, rmt_symbol_word_t symbol)
+{
+    chan->mem[chan->off % chan->mem_symbols] = symbol;
+    chan->off++;
+}
+
+static inline rmt_encode_state_t full_if_no_room(const struct rmt_channel_t *chan)
+{
+    return mem_free(chan) == 0 ? RMT_ENCODING_MEM_FULL : RMT_ENCODING_RESET;
+}
+
+// bytes encoder: one symbol per bit
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_symbol_word_t bit0;
+    rmt_symbol_word_t bit1;
+    bool msb_first;
+    size_t byte;            // where the last call stopped
+    int bit;
+} sim_bytes_encoder_t;
+
+static size_t bytes_encode(rmt_encoder_t *encoder, rmt_channel_handle_t chan,
+                           const void *data, size_t size, rmt_encode_state_t *ret_state)
+{
+    sim_bytes_encoder_t *enc = (sim_bytes_encoder_t *) encoder;
+    const uint8_t *bytes = data;
+    size_t written = 0;
+    while (enc->byte < size) {
+        if (mem_free(chan) == 0) {
+            *ret_state = RMT_ENCODING_MEM_FULL;
+            return written;
+        }
+        int shift = enc->msb_first ? 7 - enc->bit : enc->bit;
+        mem_put(chan, (bytes[enc->byte] >> shift) & 1 ? enc->bit1 : enc->bit0);
+        written++;
+        if (++enc->bit == 8) {
+            enc->bit = 0;
+            enc->byte++;
+        }
+    }
+    enc->byte = 0;
+    enc->bit = 0;
+    *ret_state = RMT_ENCODING_COMPLETE | full_if_no_room(chan);
+    return written;
+}
+
+static esp_err_t bytes_reset(rmt_encoder_t *encoder)
+{
+    sim_bytes_encoder_t *enc = (sim_bytes_encoder_t *) encoder;
+    enc->byte = 0;
+    enc->bit = 0;
+    return ESP_OK;
+}
+
+static esp_err_t free_encoder(rmt_encoder_t *encoder)
+{
+    free(encoder);
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    sim_bytes_encoder_t *enc = calloc(1, sizeof(*enc));
+    if (!enc) {
+        return ESP_ERR_NO_MEM;
+    }
+    enc->base.encode = bytes_encode;
+    enc->base.reset = bytes_reset;
+    enc->base.del = free_encoder;
+    enc->bit0 = config->bit0;
+    enc->bit1 = config->bit1;
+    enc->msb_first = config->flags.msb_first;
+    *ret_encoder = &enc->base;
+    return ESP_OK;
+}
+
+// copy encoder: the data already is symbols
+
+typedef struct {
+    rmt_encoder_t base;
+    size_t symbol;
+} sim_copy_encoder_t;
+
+static size_t copy_encode(rmt_encoder_t *encoder, rmt_channel_handle_t chan,
+                          const void *data, size_t size, rmt_encode_state_t *ret_state)
+{
+    sim_copy_encoder_t *enc = (sim_copy_encoder_t *) encoder;
+    const rmt_symbol_word_t *symbols = data;
+    size_t count = size / sizeof(rmt_symbol_word_t);
+    size_t written = 0;
+    while (enc->symbol < count) {
+        if (mem_free(chan) == 0) {
+            *ret_state = RMT_ENCODING_MEM_FULL;
+            return written;
+        }
+        mem_put(chan, symbols[enc->symbol++]);
+        written++;
+    }
+    enc->symbol = 0;
+    *ret_state = RMT_ENCODING_COMPLETE | full_if_no_room(chan);
+    return written;
+}
+
+static esp_err_t copy_reset(rmt_encoder_t *encoder)
+{
+    ((sim_copy_encoder_t *) encoder)->symbol = 0;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    (void) config;  // nothing to configure
+    sim_copy_encoder_t *enc = calloc(1, sizeof(*enc));
+    if (!enc) {
+        return ESP_ERR_NO_MEM;
+    }
+    enc->base.encode = copy_encode;
+    enc->base.reset = copy_reset;
+    enc->base.del = free_encoder;
+    *ret_encoder = &enc->base;
+    return ESP_OK;
+}
+
+// simple encoder: a callback fills the memory directly
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_encode_simple_cb_t callback;
+    void *arg;
+    size_t min_chunk_size;
+    size_t written;         // symbols_written for the callback
+    bool done;              // the callback said so, flush ovf and finish
+    rmt_symbol_word_t *ovf;
+    size_t ovf_fill;
+    size_t ovf_pos;
+} sim_simple_encoder_t;
+
+static size_t simple_encode(rmt_encoder_t *encoder, rmt_channel_handle_t chan,
+                            const void *data, size_t size, rmt_encode_state_t *ret_state)
+{
+    sim_simple_encoder_t *enc = (sim_simple_encoder_t *) encoder;
+    size_t written = 0;
+    for (;;) {
+        // whatever didn't fit last time goes first
+        while (enc->ovf_pos < enc->ovf_fill) {
+            if (mem_free(chan) == 0) {
+                *ret_state = RMT_ENCODING_MEM_FULL;
+                return written;
+            }
+            mem_put(chan, enc->ovf[enc->ovf_pos++]);
+            written++;
+        }
+        if (enc->done) {
+            break;
+        }
+        size_t free = mem_free_contiguous(chan);
+        if (free == 0) {
+            *ret_state = RMT_ENCODING_MEM_FULL;
+            return written;
+        }
+        size_t got;
+        if (free >= enc->min_chunk_size) {
+            got = enc->callback(data, size, enc->written, free, &chan->mem[chan->off % chan->mem_symbols],
+                                &enc->done, enc->arg);
+            chan->off += got;
+            written += got;
+        }
+        else {
+            // too little room, let the callback fill the overflow buffer
+            // and copy out what fits
+            got = enc->callback(data, size, enc->written, enc->min_chunk_size, enc->ovf, &enc->done, enc->arg);
+            enc->ovf_fill = got;
+            enc->ovf_pos = 0;
+        }
+        enc->written += got;
+        if (got == 0 && !enc->done) {
+            // the callback needs more room than it got
+            *ret_state = RMT_ENCODING_MEM_FULL;
+            return written;
+        }
+    }
+    enc->written = 0;
+    enc->done = false;
+    enc->ovf_fill = 0;
+    enc->ovf_pos = 0;
+    *ret_state = RMT_ENCODING_COMPLETE | full_if_no_room(chan);
+    return written;
+}
+
+static esp_err_t simple_reset(rmt_encoder_t *encoder)
+{
+    sim_simple_encoder_t *enc = (sim_simple_encoder_t *) encoder;
+    enc->written = 0;
+    enc->done = false;
+    enc->ovf_fill = 0;
+    enc->ovf_pos = 0;
+    return ESP_OK;
+}
+
+static esp_err_t simple_del(rmt_encoder_t *encoder)
+{
+    free(((sim_simple_encoder_t *) encoder)->ovf);
+    free(encoder);
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_simple_encoder(const rmt_simple_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    sim_simple_encoder_t *enc = calloc(1, sizeof(*enc));
+    if (!enc) {
+        return ESP_ERR_NO_MEM;
+    }
+    enc->base.encode = simple_encode;
+    enc->base.reset = simple_reset;
+    enc->base.del = simple_del;
+    enc->callback = config->callback;
+    enc->arg = config->arg;
+    // same default as the IDF
+    enc->min_chunk_size = config->min_chunk_size ? config->min_chunk_size : 64;
+    enc->ovf = calloc(enc->min_chunk_size, sizeof(rmt_symbol_word_t));
+    if (!enc->ovf) {
+        free(enc);
+        return ESP_ERR_NO_MEM;
+    }
+    *ret_encoder = &enc->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder)
+{
+    return encoder->del(encoder);
+}
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t encoder)
+{
+    return encoder->reset(encoder);
+}
+
+// the channel
+
+esp_err_t rmt_sim_channel_init(struct rmt_channel_t *chan, size_t mem_block_symbols)
+{
+    memset(chan, 0, sizeof(*chan));
+    if (mem_block_symbols < 2 || mem_block_symbols % 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    chan->mem = calloc(mem_block_symbols, sizeof(rmt_symbol_word_t));
+    if (!chan->mem) {
+        return ESP_ERR_NO_MEM;
+    }
+    chan->mem_symbols = mem_block_symbols;
+    return ESP_OK;
+}
+
+void rmt_sim_channel_free(struct rmt_channel_t *chan)
+{
+    free(chan->mem);
+    free(chan->wire);
+    memset(chan, 0, sizeof(*chan));
+}
+
+// append [from, chan->off) of the ring to the wire log
+static esp_err_t log_wire(struct rmt_channel_t *chan, size_t from)
+{
+    size_t count = chan->off - from;
+    if (chan->wire_count + count > chan->wire_size) {
+        size_t size = (chan->wire_count + count) * 2;
+        rmt_symbol_word_t *grown = realloc(chan->wire, size * sizeof(rmt_symbol_word_t));
+        if (!grown) {
+            return ESP_ERR_NO_MEM;
+        }
+        chan->wire = grown;
+        chan->wire_size = size;
+    }
+    for (size_t i = from; i < chan->off; i++) {
+        chan->wire[chan->wire_count++] = chan->mem[i % chan->mem_symbols];
+    }
+    return ESP_OK;
+}
+
+esp_err_t rmt_sim_transmit(struct rmt_channel_t *chan, rmt_encoder_handle_t encoder,
+                           const void *data, size_t size, rmt_sim_frame_t *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    chan->off = 0;
+    chan->wire_count = 0;
+    // the whole block to start with, then half of it each time the
+    // hardware is through the other half
+    chan->end = chan->mem_symbols;
+    for (;;) {
+        size_t from = chan->off;
+        rmt_encode_state_t state = RMT_ENCODING_RESET;
+        encoder->encode(encoder, chan, data, size, &state);
+        esp_err_t err = log_wire(chan, from);
+        if (err != ESP_OK) {
+            return err;
+        }
+        size_t filled = chan->off - from;
+        frame->symbols += filled;
+        if (frame->fills++ == 0) {
+            frame->first_fill = filled;
+        }
+        else {
+            if (frame->fills == 2 || filled < frame->refill_min) {
+                frame->refill_min = filled;
+            }
+            if (filled > frame->refill_max) {
+                frame->refill_max = filled;
+            }
+        }
+        if (state & RMT_ENCODING_COMPLETE) {
+            return ESP_OK;
+        }
+        if (filled == 0 && mem_free(chan) == chan->mem_symbols) {
+            // a whole empty block and still nothing, it would hang here
+            return ESP_FAIL;
+        }
+        chan->end += chan->mem_symbols / 2;
+        if (mem_free(chan) > chan->mem_symbols) {
+            // only ever the half that was sent
+            chan->end = chan->off + chan->mem_symbols;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+/* rmt_sim.h - a simulated RMT TX channel for the encoders in
+ * include/driver/rmt_encoder.h
+ *
+ * The channel memory is a ring of mem_block_symbols words, filled like the
+ * IDF driver does without DMA: the encoder first gets the whole block,
+ * then, each time the hardware has sent half of it, another half (a
+ * refill), until the encoder reports RMT_ENCODING_COMPLETE. Every symbol
+ * written is also appended to the channel's wire log, the stream the
+ * hardware would send.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "driver/rmt_encoder.h"
+
+struct rmt_channel_t {
+    rmt_symbol_word_t *mem;
+    size_t mem_symbols;
+    size_t off;             // next symbol written, counted from the frame start
+    size_t end;             // the current fill may write up to here
+    // everything written this frame, in order
+    rmt_symbol_word_t *wire;
+    size_t wire_count;
+    size_t wire_size;
+};
+
+typedef struct {
+    uint32_t fills;         // first fill plus refills
+    size_t symbols;
+    size_t first_fill;      // symbols written before the hardware started
+    size_t refill_min;      // symbols written by the smallest / largest
+    size_t refill_max;      // refill, 0 if there were none
+} rmt_sim_frame_t;
+
+esp_err_t rmt_sim_channel_init(struct rmt_channel_t *chan, size_t mem_block_symbols);
+void rmt_sim_channel_free(struct rmt_channel_t *chan);
+// run one rmt_transmit() of data through encoder, the wire log holds the
+// frame's symbols afterwards
+esp_err_t rmt_sim_transmit(struct rmt_channel_t *chan, rmt_encoder_handle_t encoder,
+                           const void *data, size_t size, rmt_sim_frame_t *frame);
@@ -0,0 +1,86 @@
+/* trace.c - session trace files, see trace.h
+ */
+#include <string.h>
+#include "trace.h"
+
+bool trace_from_record(const evlog_record_t *r, trace_event_t *e)
+{
+    switch (r->id) {
+    case EV_RANDOM:
+        e->kind = TRACE_RANDOM;
+        break;
+    case EV_RECEIVED:
+        e->kind = TRACE_INPUT;
+        break;
+    default:
+        return false;
+    }
+    e->at_us = r->at_us;
+    e->value = (uint32_t) r->args[0];
+    return true;
+}
+
+static bool put_varint(FILE *out, uint64_t v)
+{
+    do {
+        uint8_t b = v & 0x7f;
+        v >>= 7;
+        if (fputc(v ? b | 0x80 : b, out) == EOF) {
+            return false;
+        }
+    } while (v);
+    return true;
+}
+
+static bool get_varint(FILE *in, uint64_t *v)
+{
+    *v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(in);
+        if (c == EOF) {
+            return false;
+        }
+        *v |= (uint64_t) (c & 0x7f) << shift;
+        if ((c & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool trace_write_header(FILE *out)
+{
+    return fwrite(TRACE_MAGIC, 1, 4, out) == 4 && fputc(TRACE_VERSION, out) != EOF;
+}
+
+bool trace_write(FILE *out, const trace_event_t *e, int64_t *last_us)
+{
+    // presses are logged from the input task, after the ISR saw them, so
+    // the time can step back a little
+    int64_t delta = e->at_us - *last_us;
+    uint64_t zigzag = ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63);
+    *last_us = e->at_us;
+    return fputc(e->kind, out) != EOF && put_varint(out, zigzag) && put_varint(out, e->value);
+}
+
+bool trace_read_header(FILE *in)
+{
+    char magic[4];
+    return fread(magic, 1, 4, in) == 4 && memcmp(magic, TRACE_MAGIC, 4) == 0 &&
+           fgetc(in) == TRACE_VERSION;
+}
+
+bool trace_read(FILE *in, trace_event_t *e, int64_t *last_us)
+{
+    int kind = fgetc(in);
+    uint64_t zigzag;
+    uint64_t value;
+    if (kind == EOF || !get_varint(in, &zigzag) || !get_varint(in, &value)) {
+        return false;
+    }
+    *last_us += (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+    e->at_us = *last_us;
+    e->kind = kind;
+    e->value = value;
+    return true;
+}
@@ -0,0 +1,44 @@
+/* trace.h - session traces, everything needed to replay a session
+ *
+ * A session only differs from another by what comes in through the hal:
+ * the numbers hal_random() hands out and the presses the input handler
+ * gets. The game logs both as evlog records (EV_RANDOM, EV_RECEIVED), so a
+ * console capture from the board (or timesup_host -e) already holds them;
+ * timesup_evlog -w pulls them out into a trace and timesup_host -p plays a
+ * trace back on the virtual clock, through the same game loop.
+ *
+ * The file is "TSTR", a version byte, then one entry per event: a kind
+ * byte, the time since the previous event and the value (random number or
+ * GPIO), both as LEB128 varints, the time zigzag signed. A press costs
+ * about 4 bytes.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "evlog.h"
+
+#define TRACE_MAGIC     "TSTR"
+#define TRACE_VERSION   1
+
+typedef enum {
+    TRACE_RANDOM,       // value is what hal_random() returned
+    TRACE_INPUT,        // value is the GPIO, at_us when the ISR saw it
+} trace_kind_t;
+
+typedef struct {
+    int64_t at_us;
+    uint8_t kind;
+    uint32_t value;
+} trace_event_t;
+
+// the trace event an evlog record stands for, false if it isn't one
+bool trace_from_record(const evlog_record_t *r, trace_event_t *e);
+
+// last_us carries the previous event's time between calls, start it at 0
+bool trace_write_header(FILE *out);
+bool trace_write(FILE *out, const trace_event_t *e, int64_t *last_us);
+// false on a file that isn't a trace / at the end of the trace
+bool trace_read_header(FILE *in);
+bool trace_read(FILE *in, trace_event_t *e, int64_t *last_us);
@@ -0,0 +1,323 @@
+/* wire_emu.c - run the LED strip encoder against a simulated RMT channel
+ *
+ *   timesup_wire [-m mem_block_symbols] [-e bytes|lut|palette] [-f frames.bin] [-n pixels] [-c frames] [-r seed]
+ *
+ * Every frame goes through main/led_strip_encoder.c the way rmt_transmit()
+ * would run it (see rmt_sim.h), with a channel memory block of -m symbols
+ * (default 64, what hal_esp.c asks for). The symbols that come out are
+ * decoded like a WS2812 would: a high of more than the T0H/T1H midpoint is
+ * a 1, a low of at least 50 us latches the frame. The decoded GRB bytes
+ * have to match what went in, and every bit has to be within the WS2812
+ * timings.
+ *
+ * The frames are a recording from timesup_host -o, or -c random frames of
+ * -n pixels (default 256). In palette mode each frame is turned into a
+ * palette and indices first, a recorded frame with more than 256 colors
+ * is skipped.
+ *
+ * Prints the fills (first fill plus refills) per frame, the symbols per
+ * refill, the wire time per frame, and how long the hardware takes to send
+ * half a block, the time the driver has for each refill. Exits 1 if a
+ * frame didn't decode to its pixels.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "led_strip_encoder.h"
+#include "rmt_sim.h"
+
+#define RESOLUTION_HZ   10000000    // like hal_esp.c, 1 tick = 0.1 us
+#define TICKS_PER_US    (RESOLUTION_HZ / 1000000)
+
+// WS2812 datasheet timings, in ticks
+#define T0H_MIN         (0.25 * TICKS_PER_US)
+#define T0H_MAX         (0.55 * TICKS_PER_US)
+#define T1H_MIN         (0.65 * TICKS_PER_US)
+#define T1H_MAX         (0.95 * TICKS_PER_US)
+#define BIT_MIN         (0.65 * TICKS_PER_US)
+#define BIT_MAX         (1.85 * TICKS_PER_US)
+#define RESET_MIN       (50 * TICKS_PER_US)
+
+typedef enum {
+    MODE_BYTES,
+    MODE_LUT,
+    MODE_PALETTE,
+} encoder_mode_t;
+
+static const char *mode_names[] = { "bytes", "lut", "palette" };
+
+// what a WS2812 chain made of the wire log
+typedef struct {
+    uint8_t *grb;
+    size_t bytes;
+    bool latched;           // ended in a reset
+    uint32_t out_of_spec;   // bits outside the timings above
+    uint64_t ticks;
+} decoded_t;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t fills;
+    uint64_t refills;
+    uint64_t refill_symbols;
+    size_t refill_min;
+    size_t refill_max;
+    uint64_t ticks;
+    uint64_t out_of_spec;
+    uint64_t mismatched;
+    uint64_t skipped;
+} totals_t;
+
+static void decode(const struct rmt_channel_t *chan, decoded_t *d, size_t capacity)
+{
+    d->bytes = 0;
+    d->latched = false;
+    d->out_of_spec = 0;
+    d->ticks = 0;
+    uint32_t bit = 0;
+    const uint32_t mid = (0.3 + 0.9) / 2 * TICKS_PER_US;
+    for (size_t i = 0; i < chan->wire_count; i++) {
+        rmt_symbol_word_t s = chan->wire[i];
+        uint32_t high = s.level0 ? s.duration0 : 0;
+        uint32_t total = s.duration0 + s.duration1;
+        d->ticks += total;
+        if (!s.level0 && !s.level1) {
+            // low all the way, a reset once long enough
+            if (total >= RESET_MIN) {
+                d->latched = true;
+            }
+            else {
+                d->out_of_spec++;
+            }
+            continue;
+        }
+        if (d->latched) {
+            // bits after the reset start the next frame, not ours
+            d->out_of_spec++;
+            continue;
+        }
+        int one = high > mid;
+        if (one ? high < T1H_MIN || high > T1H_MAX : high < T0H_MIN || high > T0H_MAX) {
+            d->out_of_spec++;
+        }
+        else if (total < BIT_MIN || total > BIT_MAX) {
+            d->out_of_spec++;
+        }
+        if (d->bytes < capacity) {
+            if (bit == 0) {
+                d->grb[d->bytes] = 0;
+            }
+            d->grb[d->bytes] |= one << (7 - bit);
+        }
+        if (++bit == 8) {
+            bit = 0;
+            d->bytes++;
+        }
+    }
+    if (bit) {
+        // a partial byte is a broken frame
+        d->out_of_spec++;
+    }
+}
+
+// palette and indices for a GRB frame, false with more than 256 colors
+static bool to_palette(const uint8_t *grb, size_t pixels, uint8_t *data)
+{
+    uint8_t *palette = data;
+    uint8_t *index = data + LED_STRIP_PALETTE_BYTES;
+    int used = 0;
+    memset(palette, 0, LED_STRIP_PALETTE_BYTES);
+    for (size_t i = 0; i < pixels; i++) {
+        int e;
+        for (e = 0; e < used; e++) {
+            if (memcmp(&palette[e * 3], &grb[i * 3], 3) == 0) {
+                break;
+            }
+        }
+        if (e == used) {
+            if (used == 256) {
+                return false;
+            }
+            memcpy(&palette[used++ * 3], &grb[i * 3], 3);
+        }
+        index[i] = e;
+    }
+    return true;
+}
+
+// the next frame, recorded or random; false when there are no more
+static bool next_frame(FILE *in, uint8_t **grb, size_t *size, size_t pixels)
+{
+    if (in) {
+        int64_t start;
+        uint32_t len;
+        if (fread(&start, sizeof(start), 1, in) != 1 || fread(&len, sizeof(len), 1, in) != 1) {
+            return false;
+        }
+        if (len > *size) {
+            uint8_t *grown = realloc(*grb, len);
+            if (!grown) {
+                return false;
+            }
+            *grb = grown;
+        }
+        *size = len;
+        return fread(*grb, 1, len, in) == len;
+    }
+    *size = pixels * 3;
+    for (size_t i = 0; i < *size; i++) {
+        (*grb)[i] = rand();
+    }
+    return true;
+}
+
+static int run(encoder_mode_t mode, size_t mem_block_symbols, FILE *in, size_t pixels, long count)
+{
+    led_strip_encoder_config_t config = {
+        .resolution = RESOLUTION_HZ,
+        .use_lut = mode != MODE_BYTES,
+        .palette = mode == MODE_PALETTE,
+    };
+    rmt_encoder_handle_t encoder;
+    ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&config, &encoder));
+    struct rmt_channel_t chan;
+    ESP_ERROR_CHECK(rmt_sim_channel_init(&chan, mem_block_symbols));
+
+    size_t size = pixels * 3;
+    uint8_t *grb = malloc(size);
+    uint8_t *data = NULL;
+    decoded_t d = { .grb = NULL };
+    totals_t t = { .refill_min = SIZE_MAX };
+    while ((in || (long) t.frames + (long) t.skipped < count) && next_frame(in, &grb, &size, pixels)) {
+        const uint8_t *tx = grb;
+        size_t tx_size = size;
+        if (mode == MODE_PALETTE) {
+            data = realloc(data, LED_STRIP_PALETTE_BYTES + size / 3);
+            if (!to_palette(grb, size / 3, data)) {
+                t.skipped++;
+                continue;
+            }
+            tx = data;
+            tx_size = LED_STRIP_PALETTE_BYTES + size / 3;
+        }
+        d.grb = realloc(d.grb, size);
+
+        rmt_sim_frame_t frame;
+        esp_err_t err = rmt_sim_transmit(&chan, encoder, tx, tx_size, &frame);
+        if (err != ESP_OK) {
+            fprintf(stderr, "frame %llu: transmit failed, error 0x%x\n", (unsigned long long) t.frames, err);
+            t.mismatched++;
+            t.frames++;
+            continue;
+        }
+        decode(&chan, &d, size);
+        if (!d.latched || d.bytes != size || memcmp(d.grb, grb, size) != 0) {
+            if (t.mismatched == 0) {
+                fprintf(stderr, "frame %llu: decoded %zu of %zu bytes%s\n", (unsigned long long) t.frames,
+                        d.bytes, size, d.latched ? "" : ", no reset");
+            }
+            t.mismatched++;
+        }
+        t.frames++;
+        t.fills += frame.fills;
+        t.ticks += d.ticks;
+        t.out_of_spec += d.out_of_spec;
+        // refills are the fills with a deadline; the last one is usually
+        // short, it only has the end of the frame
+        if (frame.fills > 1) {
+            t.refills += frame.fills - 1;
+            t.refill_symbols += frame.symbols - frame.first_fill;
+            if (frame.refill_min < t.refill_min) {
+                t.refill_min = frame.refill_min;
+            }
+            if (frame.refill_max > t.refill_max) {
+                t.refill_max = frame.refill_max;
+            }
+        }
+    }
+
+    uint64_t n = t.frames ? t.frames : 1;
+    double bit_us = (0.3 + 0.9);
+    printf("encoder       %s, %zu symbol memory block\n", mode_names[mode], mem_block_symbols);
+    printf("frames        %llu decoded, %llu mismatched, %llu skipped\n", (unsigned long long) t.frames,
+           (unsigned long long) t.mismatched, (unsigned long long) t.skipped);
+    printf("fills/frame   %.1f (1 + %.1f refills)\n", (double) t.fills / n, (double) t.refills / n);
+    printf("per refill    %.1f symbols, min %zu, max %zu\n", t.refills ? (double) t.refill_symbols / t.refills : 0.0,
+           t.refill_min == SIZE_MAX ? 0 : t.refill_min, t.refill_max);
+    printf("wire time     %.1f us/frame\n", (double) t.ticks / TICKS_PER_US / n);
+    printf("refill window %.1f us (half a block of bits)\n", mem_block_symbols / 2 * bit_us);
+    printf("out of spec   %llu bits\n", (unsigned long long) t.out_of_spec);
+
+    rmt_sim_channel_free(&chan);
+    rmt_del_encoder(encoder);
+    free(grb);
+    free(data);
+    free(d.grb);
+    return t.mismatched ? 1 : 0;
+}
+
+// the encoder logs through ESP_LOGE, hal_host.c isn't linked here
+int host_log_enabled(void)
+{
+    return 1;
+}
+
+long long host_log_time_ms(void)
+{
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    size_t mem_block_symbols = 64;
+    encoder_mode_t mode = MODE_LUT;
+    FILE *in = NULL;
+    size_t pixels = 256;
+    long count = 100;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:e:f:n:c:r:h")) != -1) {
+        switch (opt) {
+        case 'm':
+            mem_block_symbols = strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            for (mode = 0; mode < 3 && strcmp(optarg, mode_names[mode]) != 0; mode++) {
+            }
+            if (mode == 3) {
+                fprintf(stderr, "unknown encoder %s, bytes, lut or palette\n", optarg);
+                return 1;
+            }
+            break;
+        case 'f':
+            in = fopen(optarg, "rb");
+            if (!in) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        case 'n':
+            pixels = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            count = atol(optarg);
+            break;
+        case 'r':
+            srand(atoi(optarg));
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-m mem_block_symbols] [-e bytes|lut|palette] [-f frames.bin] [-n pixels] [-c frames] [-r seed]\n", argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (mem_block_symbols < 16 || mem_block_symbols % 2) {
+        // the LUT modes need a byte (8 symbols) per half block
+        fprintf(stderr, "mem_block_symbols must be even and at least 16\n");
+        return 1;
+    }
+    int ret = run(mode, mem_block_symbols, in, pixels, count);
+    if (in) {
+        fclose(in);
+    }
+    return ret;
+}
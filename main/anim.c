@@ -0,0 +1,264 @@
+/* anim.c - keyframed glyph animation, see anim.h
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "anim.h"
+
+const anim_pose_t anim_rest = {
+    .value = {
+        [ANIM_X] = 0,
+        [ANIM_Y] = 0,
+        [ANIM_ANGLE] = 0,
+        [ANIM_SCALE] = ANIM_ONE,
+        [ANIM_BRIGHTNESS] = LAYER_OPAQUE,
+    },
+};
+
+// the smallest scale a sprite is drawn at, keeps the steps in range
+#define MIN_SCALE (ANIM_ONE / 16)
+
+// sin(i / 64 * 90 degrees) in Q14
+static const int16_t sine_quarter[65] = {
+    0, 402, 804, 1205, 1606, 2006, 2404, 2801,
+    3196, 3590, 3981, 4370, 4756, 5139, 5520, 5897,
+    6270, 6639, 7005, 7366, 7723, 8076, 8423, 8765,
+    9102, 9434, 9760, 10080, 10394, 10702, 11003, 11297,
+    11585, 11866, 12140, 12406, 12665, 12916, 13160, 13395,
+    13623, 13842, 14053, 14256, 14449, 14635, 14811, 14978,
+    15137, 15286, 15426, 15557, 15679, 15791, 15893, 15986,
+    16069, 16143, 16207, 16261, 16305, 16340, 16364, 16379,
+    16384,
+};
+
+// f(i / 64) in Q16 for each curve but linear
+static const int32_t ease_table[ANIM_EASES - 1][65] = {
+    [ANIM_EASE_IN - 1] = {              // t^3
+        0, 0, 2, 7, 16, 31, 54, 86,
+        128, 182, 250, 333, 432, 549, 686, 844,
+        1024, 1228, 1458, 1715, 2000, 2315, 2662, 3042,
+        3456, 3906, 4394, 4921, 5488, 6097, 6750, 7448,
+        8192, 8984, 9826, 10719, 11664, 12663, 13718, 14830,
+        16000, 17230, 18522, 19877, 21296, 22781, 24334, 25956,
+        27648, 29412, 31250, 33163, 35152, 37219, 39366, 41594,
+        43904, 46298, 48778, 51345, 54000, 56745, 59582, 62512,
+        65536,
+    },
+    [ANIM_EASE_OUT - 1] = {             // 1 - (1 - t)^3
+        0, 3024, 5954, 8791, 11536, 14191, 16758, 19238,
+        21632, 23942, 26170, 28317, 30384, 32373, 34286, 36124,
+        37888, 39580, 41202, 42755, 44240, 45659, 47014, 48306,
+        49536, 50706, 51818, 52873, 53872, 54817, 55710, 56552,
+        57344, 58088, 58786, 59439, 60048, 60615, 61142, 61630,
+        62080, 62494, 62874, 63221, 63536, 63821, 64078, 64308,
+        64512, 64692, 64850, 64987, 65104, 65203, 65286, 65354,
+        65408, 65450, 65482, 65505, 65520, 65529, 65534, 65536,
+        65536,
+    },
+    [ANIM_EASE_IN_OUT - 1] = {          // 4t^3, mirrored from t = 1/2
+        0, 1, 8, 27, 64, 125, 216, 343,
+        512, 729, 1000, 1331, 1728, 2197, 2744, 3375,
+        4096, 4913, 5832, 6859, 8000, 9261, 10648, 12167,
+        13824, 15625, 17576, 19683, 21952, 24389, 27000, 29791,
+        32768, 35745, 38536, 41147, 43584, 45853, 47960, 49911,
+        51712, 53369, 54888, 56275, 57536, 58677, 59704, 60623,
+        61440, 62161, 62792, 63339, 63808, 64205, 64536, 64807,
+        65024, 65193, 65320, 65411, 65472, 65509, 65528, 65535,
+        65536,
+    },
+    [ANIM_EASE_OUT_BACK - 1] = {        // 1 + 2.70158 (t - 1)^3 + 1.70158 (t - 1)^2
+        0, 4713, 9224, 13539, 17662, 21595, 25344, 28913,
+        32304, 35524, 38575, 41461, 44187, 46757, 49175, 51444,
+        53570, 55555, 57404, 59122, 60711, 62177, 63523, 64753,
+        65871, 66882, 67789, 68597, 69309, 69929, 70463, 70913,
+        71283, 71579, 71803, 71960, 72054, 72089, 72070, 71999,
+        71881, 71721, 71521, 71288, 71023, 70732, 70418, 70086,
+        69739, 69382, 69019, 68653, 68289, 67931, 67583, 67249,
+        66933, 66638, 66370, 66132, 65928, 65763, 65639, 65563,
+        65536,
+    },
+};
+
+int32_t anim_ease(anim_ease_t ease, int32_t t)
+{
+    if (t <= 0) {
+        return 0;
+    }
+    if (t >= 65536) {
+        return 65536;
+    }
+    if (ease == ANIM_EASE_LINEAR || ease >= ANIM_EASES) {
+        return t;
+    }
+    const int32_t *table = ease_table[ease - 1];
+    int i = t >> 10;
+    int32_t frac = t & 1023;
+    return table[i] + ((table[i + 1] - table[i]) * frac >> 10);
+}
+
+int32_t anim_sin(int32_t angle)
+{
+    uint32_t a = (uint32_t) angle & (ANIM_TURN - 1);
+    uint32_t quadrant = a >> 14;
+    uint32_t r = a & 0x3fff;
+    if (quadrant & 1) {
+        r = 0x4000 - r;
+    }
+    int i = r >> 8;
+    int32_t frac = r & 0xff;
+    int32_t s = i == 64 ? sine_quarter[64] :
+                sine_quarter[i] + ((sine_quarter[i + 1] - sine_quarter[i]) * frac >> 8);
+    return quadrant & 2 ? -s : s;
+}
+
+int32_t anim_cos(int32_t angle)
+{
+    return anim_sin(angle + ANIM_TURN / 4);
+}
+
+void anim_clear(anim_t *a)
+{
+    memset(a, 0, sizeof(*a));
+}
+
+bool anim_key(anim_t *a, anim_track_t track, int32_t at_ms, int32_t value, anim_ease_t ease)
+{
+    anim_curve_t *curve = &a->tracks[track];
+    if (curve->count == ANIM_MAX_KEYS) {
+        return false;
+    }
+    curve->keys[curve->count++] = (anim_key_t) { .at_ms = at_ms, .value = value, .ease = ease };
+    if (at_ms > a->length_ms) {
+        a->length_ms = at_ms;
+    }
+    return true;
+}
+
+void anim_start(anim_t *a, int64_t now_us)
+{
+    a->start_us = now_us;
+}
+
+static int32_t curve_value(const anim_curve_t *curve, int64_t t_us, int32_t rest)
+{
+    if (curve->count == 0) {
+        return rest;
+    }
+    const anim_key_t *keys = curve->keys;
+    if (t_us <= (int64_t) keys[0].at_ms * 1000) {
+        return keys[0].value;
+    }
+    for (int k = 1; k < curve->count; k++) {
+        int64_t to = (int64_t) keys[k].at_ms * 1000;
+        if (t_us < to) {
+            int64_t from = (int64_t) keys[k - 1].at_ms * 1000;
+            int32_t p = (t_us - from) * 65536 / (to - from);
+            int32_t eased = anim_ease(keys[k].ease, p);
+            return keys[k - 1].value + (int32_t) ((int64_t) (keys[k].value - keys[k - 1].value) * eased >> 16);
+        }
+    }
+    return keys[curve->count - 1].value;
+}
+
+bool anim_pose(const anim_t *a, int64_t now_us, anim_pose_t *pose)
+{
+    int64_t t_us = now_us - a->start_us;
+    for (int track = 0; track < ANIM_TRACKS; track++) {
+        pose->value[track] = curve_value(&a->tracks[track], t_us, anim_rest.value[track]);
+    }
+    return t_us < (int64_t) a->length_ms * 1000;
+}
+
+void anim_sprite_init(anim_sprite_t *s, layer_id_t layer, int scale)
+{
+    memset(s, 0, sizeof(*s));
+    s->layer = layer;
+    s->scale = scale;
+}
+
+void anim_sprite_forget(anim_sprite_t *s)
+{
+    memset(s->lit, 0, sizeof(s->lit));
+}
+
+void anim_sprite_draw(anim_sprite_t *s, const uint16_t *rows, int w, int h, const anim_pose_t *pose,
+                      uint32_t red, uint32_t green, uint32_t blue)
+{
+    const int32_t *v = pose->value;
+    int32_t scale = v[ANIM_SCALE] * s->scale;
+    if (scale < MIN_SCALE) {
+        scale = MIN_SCALE;
+    }
+    // glyph pixels per display pixel along x and y, Q16
+    int32_t step = (1 << 24) / scale;
+    int32_t c = anim_cos(v[ANIM_ANGLE]);
+    int32_t sn = anim_sin(v[ANIM_ANGLE]);
+    int32_t du_dx = (int64_t) c * step >> 14;
+    int32_t du_dy = (int64_t) sn * step >> 14;
+    int32_t dv_dx = -du_dy;
+    int32_t dv_dy = du_dx;
+
+    // the glyph's center on the display, Q16, and the glyph coordinates
+    // of the middle of pixel 0, 0
+    int32_t cx = (SIZE_X << 15) + (v[ANIM_X] << 8);
+    int32_t cy = (SIZE_Y << 15) + (v[ANIM_Y] << 8);
+    int32_t x0 = 0x8000 - cx;
+    int32_t y0 = 0x8000 - cy;
+    int32_t u00 = (w << 15) + (int32_t) (((int64_t) du_dx * x0 + (int64_t) du_dy * y0) >> 16);
+    int32_t v00 = (h << 15) + (int32_t) (((int64_t) dv_dx * x0 + (int64_t) dv_dy * y0) >> 16);
+
+    // the rotated glyph's bounding box, Q16 half extents
+    int32_t ex = (int32_t) (((int64_t) (abs(c) * w + abs(sn) * h) * scale) >> 7);
+    int32_t ey = (int32_t) (((int64_t) (abs(sn) * w + abs(c) * h) * scale) >> 7);
+    int x_lo = (cx - ex) >> 16;
+    int x_hi = ((cx + ex) >> 16) + 1;
+    int y_lo = (cy - ey) >> 16;
+    int y_hi = ((cy + ey) >> 16) + 1;
+    x_lo = x_lo < 0 ? 0 : x_lo;
+    y_lo = y_lo < 0 ? 0 : y_lo;
+    x_hi = x_hi > SIZE_X ? SIZE_X : x_hi;
+    y_hi = y_hi > SIZE_Y ? SIZE_Y : y_hi;
+
+    // brightness scales the color, black is see-through rather than a
+    // black glyph; unlike layer opacity this looks the same on an indexed
+    // framebuffer
+    int32_t brightness = v[ANIM_BRIGHTNESS];
+    brightness = brightness < 0 ? 0 : brightness > LAYER_OPAQUE ? LAYER_OPAQUE : brightness;
+    red = (red * brightness + LAYER_OPAQUE / 2) / LAYER_OPAQUE;
+    green = (green * brightness + LAYER_OPAQUE / 2) / LAYER_OPAQUE;
+    blue = (blue * brightness + LAYER_OPAQUE / 2) / LAYER_OPAQUE;
+    if ((red | green | blue) == 0) {
+        x_hi = x_lo;
+    }
+
+    bool recolor = s->rgb[0] != red || s->rgb[1] != green || s->rgb[2] != blue;
+    s->rgb[0] = red;
+    s->rgb[1] = green;
+    s->rgb[2] = blue;
+    for (int x = 0; x < SIZE_X; x++) {
+        uint32_t lit = 0;
+        if (x >= x_lo && x < x_hi) {
+            int32_t u = u00 + x * du_dx + y_lo * du_dy;
+            int32_t vv = v00 + x * dv_dx + y_lo * dv_dy;
+            for (int y = y_lo; y < y_hi; y++, u += du_dy, vv += dv_dy) {
+                int32_t col = u >> 16;
+                int32_t row = vv >> 16;
+                if ((uint32_t) col < (uint32_t) w && (uint32_t) row < (uint32_t) h &&
+                    (rows[row] >> (w - 1 - col)) & 1) {
+                    lit |= 1u << y;
+                }
+            }
+        }
+        uint32_t changed = recolor ? lit | s->lit[x] : lit ^ s->lit[x];
+        while (changed) {
+            int y = __builtin_ctz(changed);
+            changed &= changed - 1;
+            if (lit & (1u << y)) {
+                layer_set_rgb(s->layer, xy_to_strip(x, y), red, green, blue);
+            }
+            else {
+                layer_clear_pixel(s->layer, xy_to_strip(x, y));
+            }
+        }
+        s->lit[x] = lit;
+    }
+}
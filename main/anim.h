@@ -0,0 +1,102 @@
+/* anim.h - keyframed glyph animation in fixed point
+ *
+ * An animation has one track per property of a pose: x and y offset,
+ * angle, scale and brightness. Each track holds up to ANIM_MAX_KEYS
+ * keyframes (time since the start, value, and the easing curve used on
+ * the way into the key). Evaluating a pose is integer only. The easing
+ * curves and the sine are interpolated from constant tables, so there is
+ * no float on the frame path, and the cost per frame is fixed: a lookup
+ * per track.
+ *
+ * A sprite draws a row-major glyph bitmap (one word per row, leftmost pixel
+ * in bit w-1, like bitmaps_12x12) into a layer through a pose. Every
+ * display pixel in the rotated glyph's bounding box is mapped back into
+ * the bitmap (a rotate and scale done with adds from per-frame steps) and
+ * takes the nearest glyph pixel. The cost is therefore bounded by the
+ * box, at most the display. Only pixels that changed since the sprite's
+ * last frame are written. At a right angle and scale ANIM_ONE the result
+ * is exactly the prebuilt GLYPH_ROT_* variant. Brightness scales the
+ * color, and a sprite faded to black is transparent.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "compositor.h"
+
+#define ANIM_ONE        256                 // Q8 1.0, scale and positions
+#define ANIM_TURN       65536               // angle units per turn
+#define ANIM_DEG(d)     ((int32_t) (d) * ANIM_TURN / 360)
+#define ANIM_MAX_KEYS   4
+
+_Static_assert(SIZE_Y <= 32, "anim_sprite_t keeps a column in a word");
+
+typedef enum {
+    ANIM_X,             // Q8 display pixels, right of the home position
+    ANIM_Y,             // Q8 display pixels, up
+    ANIM_ANGLE,         // ANIM_TURN a turn, the way GLYPH_ROT_90 turns
+    ANIM_SCALE,         // Q8, ANIM_ONE for the glyph's normal size
+    ANIM_BRIGHTNESS,    // 0 .. LAYER_OPAQUE, scales the color
+    ANIM_TRACKS,
+} anim_track_t;
+
+typedef enum {
+    ANIM_EASE_LINEAR,
+    ANIM_EASE_IN,       // cubic, slow start
+    ANIM_EASE_OUT,      // cubic, slow end
+    ANIM_EASE_IN_OUT,
+    ANIM_EASE_OUT_BACK, // overshoots a little and settles
+    ANIM_EASES,
+} anim_ease_t;
+
+typedef struct {
+    int32_t at_ms;
+    int32_t value;
+    uint8_t ease;       // anim_ease_t from the key before
+} anim_key_t;
+
+typedef struct {
+    anim_key_t keys[ANIM_MAX_KEYS];
+    uint8_t count;
+} anim_curve_t;
+
+typedef struct {
+    int32_t value[ANIM_TRACKS];
+} anim_pose_t;
+
+typedef struct {
+    anim_curve_t tracks[ANIM_TRACKS];
+    int64_t start_us;
+    int32_t length_ms;  // the last key of any track
+} anim_t;
+
+// the pose of a track without keys
+extern const anim_pose_t anim_rest;
+
+// t (Q16, 0 .. 65536) through an easing curve, Q16
+int32_t anim_ease(anim_ease_t ease, int32_t t);
+// Q14 sine and cosine of an angle in ANIM_TURN units
+int32_t anim_sin(int32_t angle);
+int32_t anim_cos(int32_t angle);
+
+// no keys, every track at rest
+void anim_clear(anim_t *a);
+// add a key to a track, keys go in time order; false if the track is full
+bool anim_key(anim_t *a, anim_track_t track, int32_t at_ms, int32_t value, anim_ease_t ease);
+void anim_start(anim_t *a, int64_t now_us);
+// the pose at now_us; false once past the last key, the pose then stays
+bool anim_pose(const anim_t *a, int64_t now_us, anim_pose_t *pose);
+
+typedef struct {
+    layer_id_t layer;
+    int scale;              // display pixels per glyph pixel at ANIM_ONE
+    uint32_t lit[SIZE_X];   // pixels the sprite has set, bit y of column x
+    uint8_t rgb[3];
+} anim_sprite_t;
+
+void anim_sprite_init(anim_sprite_t *s, layer_id_t layer, int scale);
+// draw the w x h bitmap rows centered on the display, moved by pose
+void anim_sprite_draw(anim_sprite_t *s, const uint16_t *rows, int w, int h, const anim_pose_t *pose,
+                      uint32_t red, uint32_t green, uint32_t blue);
+// the layer was cleared by someone else, nothing of the sprite is left
+void anim_sprite_forget(anim_sprite_t *s);
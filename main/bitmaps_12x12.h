@@ -1,77 +0,0 @@
-/* bitmaps.h - bitmap constants for 12x12
-*/
-
-const short int bitmap_blank12x12[144] = {
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-};
-
-const short int bitmap_bang12x12[144] = {
-    0,0,0,0,0,1,1,0,0,0,0,0,
-    0,0,0,0,0,1,1,0,0,0,0,0,
-    0,0,0,0,1,1,1,1,0,0,0,0,
-    0,0,0,0,1,1,1,1,0,0,0,0,
-    0,0,0,0,1,1,1,1,0,0,0,0,
-    0,0,0,0,1,1,1,1,0,0,0,0,
-    0,0,0,0,0,1,1,0,0,0,0,0,
-    0,0,0,0,0,1,1,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,1,1,0,0,0,0,0,
-    0,0,0,0,1,1,1,1,0,0,0,0,
-    0,0,0,0,0,1,1,0,0,0,0,0,
-};
-
-const short int bitmap_left12x12[144] = {
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,1,0,0,0,0,0,0,
-    0,0,0,0,1,1,0,0,0,0,0,0,
-    0,0,0,1,1,1,0,0,0,0,0,0,
-    0,0,1,1,1,1,0,0,0,0,0,0,
-    0,1,1,1,1,1,1,1,1,1,1,1,
-    1,1,1,1,1,1,1,1,1,1,1,1,
-    0,1,1,1,1,1,1,1,1,1,1,1,
-    0,0,1,1,1,1,0,0,0,0,0,0,
-    0,0,0,1,1,1,0,0,0,0,0,0,
-    0,0,0,0,1,1,0,0,0,0,0,0,
-    0,0,0,0,0,1,0,0,0,0,0,0,
-};
-
-const short int bitmap_check12x12[144] = {
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,1,1,1,
-    0,0,0,0,0,0,0,0,1,0,0,0,
-    0,0,0,0,0,0,0,1,1,0,0,0,
-    0,0,0,0,0,0,1,1,0,0,0,0,
-    0,1,0,0,0,1,1,1,0,0,0,0,
-    0,1,1,0,1,1,1,0,0,0,0,0,
-    0,0,1,1,1,1,0,0,0,0,0,0,
-    0,0,0,1,1,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,
-};
-
-const short int bitmap_x12x12[144] = {
-    1,1,0,0,0,0,0,0,0,0,0,1,
-    0,1,1,0,0,0,0,0,0,0,1,0,
-    0,0,1,1,0,0,0,0,0,1,0,0,
-    0,0,0,1,1,0,0,0,1,0,0,0,
-    0,0,0,0,1,1,0,1,0,0,0,0,
-    0,0,0,0,0,1,1,0,0,0,0,0,
-    0,0,0,0,0,1,1,1,0,0,0,0,
-    0,0,0,0,1,0,0,1,1,0,0,0,
-    0,0,0,1,0,0,0,0,1,1,0,0,
-    0,0,1,0,0,0,0,0,0,1,1,0,
-    0,1,0,0,0,0,0,0,0,0,1,1,
-    1,0,0,0,0,0,0,0,0,0,0,1,
-};
\ No newline at end of file
@@ -0,0 +1,220 @@
+/* compositor.c - layers merged into the strip buffer, see compositor.h
+ */
+#include <string.h>
+#include "compositor.h"
+
+#define DIRTY_WORDS ((STRIP_LENGTH + 31) / 32)
+
+typedef struct {
+#if FRAMEBUFFER_INDEXED
+    uint8_t color[STRIP_LENGTH];        // palette entry
+#else
+    uint8_t grb[STRIP_LENGTH * 3];
+#endif
+    uint8_t coverage[STRIP_LENGTH];
+    // covered pixels are all inside [lo, hi)
+    uint16_t lo;
+    uint16_t hi;
+    bool visible;
+    uint8_t opacity;
+} layer_t;
+
+static layer_t layers[LAYER_COUNT];
+// strip pixels whose layers changed since the last merge
+static uint32_t dirty[DIRTY_WORDS];
+
+static inline void mark(uint32_t index)
+{
+    dirty[index >> 5] |= 1u << (index & 31);
+}
+
+static void mark_range(uint32_t lo, uint32_t hi)
+{
+    for (uint32_t i = lo; i < hi; i++) {
+        mark(i);
+    }
+}
+
+void compositor_setup(void)
+{
+    for (int l = 0; l < LAYER_COUNT; l++) {
+        memset(&layers[l], 0, sizeof(layers[l]));
+        layers[l].lo = STRIP_LENGTH;
+        layers[l].hi = 0;
+        layers[l].visible = true;
+        layers[l].opacity = LAYER_OPAQUE;
+    }
+    // the strip may hold anything, merge it all once
+    mark_range(0, STRIP_LENGTH);
+}
+
+static inline void cover(layer_t *ly, uint32_t index)
+{
+    ly->coverage[index] = LAYER_OPAQUE;
+    if (index < ly->lo) {
+        ly->lo = index;
+    }
+    if (index >= ly->hi) {
+        ly->hi = index + 1;
+    }
+    mark(index);
+}
+
+#if FRAMEBUFFER_INDEXED
+void layer_set_color(layer_id_t layer, uint32_t index, uint8_t color)
+{
+    layer_t *ly = &layers[layer];
+    if (ly->coverage[index] == LAYER_OPAQUE && ly->color[index] == color) {
+        return;
+    }
+    ly->color[index] = color;
+    cover(ly, index);
+}
+
+void layer_set_grb(layer_id_t layer, uint32_t index, const uint8_t *grb)
+{
+    layer_set_color(layer, index, palette_rgb(grb[1], grb[0], grb[2]));
+}
+#else
+void layer_set_grb(layer_id_t layer, uint32_t index, const uint8_t *grb)
+{
+    layer_t *ly = &layers[layer];
+    uint8_t *p = &ly->grb[index * 3];
+    if (ly->coverage[index] == LAYER_OPAQUE && p[0] == grb[0] && p[1] == grb[1] && p[2] == grb[2]) {
+        return;
+    }
+    p[0] = grb[0];
+    p[1] = grb[1];
+    p[2] = grb[2];
+    cover(ly, index);
+}
+#endif
+
+void layer_set_rgb(layer_id_t layer, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    const uint8_t grb[3] = { green, red, blue };
+    layer_set_grb(layer, index, grb);
+}
+
+void layer_clear_pixel(layer_id_t layer, uint32_t index)
+{
+    layer_t *ly = &layers[layer];
+    if (ly->coverage[index] != 0) {
+        ly->coverage[index] = 0;
+        mark(index);
+    }
+}
+
+void layer_clear(layer_id_t layer)
+{
+    layer_t *ly = &layers[layer];
+    for (uint32_t i = ly->lo; i < ly->hi; i++) {
+        layer_clear_pixel(layer, i);
+    }
+    ly->lo = STRIP_LENGTH;
+    ly->hi = 0;
+}
+
+void layer_blit_columns_rgb(layer_id_t layer, const uint16_t *columns,
+                            int size_x, int size_y, int offset_x, int offset_y,
+                            uint32_t red, uint32_t green, uint32_t blue)
+{
+    const uint8_t grb[3] = { green, red, blue };
+    for (int i = 0; i < size_x; i++) {
+        uint32_t bits = columns[i];
+        for (int j = 0; j < size_y; j++) {
+            uint32_t index = xy_to_strip(i + offset_x, j + offset_y);
+            if (bits & (1u << j)) {
+                layer_set_grb(layer, index, grb);
+            }
+            else {
+                layer_clear_pixel(layer, index);
+            }
+        }
+    }
+}
+
+void layer_set_visible(layer_id_t layer, bool visible)
+{
+    layer_t *ly = &layers[layer];
+    if (ly->visible != visible) {
+        ly->visible = visible;
+        mark_range(ly->lo, ly->hi);
+    }
+}
+
+void layer_set_opacity(layer_id_t layer, uint8_t opacity)
+{
+    layer_t *ly = &layers[layer];
+    if (ly->opacity != opacity) {
+        ly->opacity = opacity;
+        if (ly->visible) {
+            mark_range(ly->lo, ly->hi);
+        }
+    }
+}
+
+bool compositor_dirty(void)
+{
+    for (int w = 0; w < DIRTY_WORDS; w++) {
+        if (dirty[w]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#if FRAMEBUFFER_INDEXED
+// the top layer showing at one strip pixel, palette colors don't blend
+static void merge_pixel(uint32_t index)
+{
+    uint8_t color = 0;
+    for (int l = 0; l < LAYER_COUNT; l++) {
+        const layer_t *ly = &layers[l];
+        if (ly->visible && ly->coverage[index] * ly->opacity > LAYER_OPAQUE * LAYER_OPAQUE / 2) {
+            color = ly->color[index];
+        }
+    }
+    set_index_color(index, color);
+}
+#else
+// the layers at one strip pixel, bottom to top
+static void merge_pixel(uint32_t index)
+{
+    uint32_t c[3] = { 0, 0, 0 };
+    for (int l = 0; l < LAYER_COUNT; l++) {
+        const layer_t *ly = &layers[l];
+        uint32_t cover = ly->coverage[index];
+        if (!ly->visible || cover == 0) {
+            continue;
+        }
+        const uint8_t *p = &ly->grb[index * 3];
+        uint32_t a = cover * ly->opacity / LAYER_OPAQUE;
+        if (a == LAYER_OPAQUE) {
+            c[0] = p[0];
+            c[1] = p[1];
+            c[2] = p[2];
+        }
+        else {
+            for (int k = 0; k < 3; k++) {
+                c[k] = (c[k] * (LAYER_OPAQUE - a) + p[k] * a + LAYER_OPAQUE / 2) / LAYER_OPAQUE;
+            }
+        }
+    }
+    const uint8_t grb[3] = { c[0], c[1], c[2] };
+    set_index_grb(index, grb);
+}
+#endif
+
+void compositor_merge(void)
+{
+    for (int w = 0; w < DIRTY_WORDS; w++) {
+        uint32_t bits = dirty[w];
+        dirty[w] = 0;
+        while (bits) {
+            int bit = __builtin_ctz(bits);
+            bits &= bits - 1;
+            merge_pixel(w * 32 + bit);
+        }
+    }
+}
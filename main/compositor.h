@@ -0,0 +1,62 @@
+/* compositor.h - named layers merged into the strip buffer
+ *
+ * Each layer is a full strip sized GRB buffer with a coverage byte per
+ * pixel (0 is transparent), a visibility flag and an opacity. Layers stack
+ * in layer_id_t order, the spiral at the bottom and the HUD on top. Drawing
+ * goes into a layer and only marks the pixels it changes; showing, hiding
+ * or fading a layer marks the pixels it covers. compositor_merge() then
+ * recomputes just the marked pixels and writes them into led_strip_pixels,
+ * where the framebuffer's own dirty tracking takes over.
+ *
+ * So nothing needs clearing before a redraw: replace or clear the one
+ * layer that changed and the pixels underneath come back by themselves.
+ *
+ * With FRAMEBUFFER_INDEXED layers hold palette entries instead of GRB, and
+ * as palette colors can't be mixed the opacity only decides whether a
+ * layer shows (above half) or not.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "framebuffer.h"
+
+typedef enum {
+    LAYER_SPIRAL,       // progress spiral, background
+    LAYER_GLYPH,        // 12x12 glyph in the center
+    LAYER_HUD,          // score and time digits
+    LAYER_COUNT,
+} layer_id_t;
+
+#define LAYER_OPAQUE 255
+
+// all layers empty, visible and opaque
+void compositor_setup(void);
+
+// cover a pixel of a layer with a color (coverage LAYER_OPAQUE)
+void layer_set_grb(layer_id_t layer, uint32_t index, const uint8_t *grb);
+void layer_set_rgb(layer_id_t layer, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
+#if FRAMEBUFFER_INDEXED
+// same with a palette entry
+void layer_set_color(layer_id_t layer, uint32_t index, uint8_t color);
+#endif
+// make a pixel of a layer transparent again
+void layer_clear_pixel(layer_id_t layer, uint32_t index);
+// make the whole layer transparent, only covered pixels are touched
+void layer_clear(layer_id_t layer);
+
+// a column-major bitmap (one word per column, bit j = row j) into the
+// size_x by size_y box at offset_x, offset_y: set bits in the color, clear
+// bits transparent, so whatever was in the box before is replaced
+void layer_blit_columns_rgb(layer_id_t layer, const uint16_t *columns,
+                            int size_x, int size_y, int offset_x, int offset_y,
+                            uint32_t red, uint32_t green, uint32_t blue);
+
+void layer_set_visible(layer_id_t layer, bool visible);
+// 0 (invisible) .. LAYER_OPAQUE, blended over the layers below
+void layer_set_opacity(layer_id_t layer, uint8_t opacity);
+
+// anything to merge?
+bool compositor_dirty(void);
+// bring led_strip_pixels up to date with the layers
+void compositor_merge(void);
@@ -0,0 +1,194 @@
+/* evlog.c - deferred binary log, see evlog.h
+ *
+ * The ring is multi producer (any task or ISR calling evlog_at()) and
+ * single consumer (evlog_drain()). A producer claims a slot by moving head
+ * with a compare and swap, fills it and then sets its ready flag; the
+ * consumer takes slots in order at tail and stops at the first one that
+ * isn't ready yet.
+ */
+#include <string.h>
+#include "evlog.h"
+
+typedef struct {
+    volatile uint32_t ready;
+    evlog_record_t record;
+} evlog_slot_t;
+
+static evlog_slot_t ring[EVLOG_RING_SIZE];
+static uint32_t head = 0;
+static uint32_t tail = 0;
+static uint32_t dropped = 0;
+
+static FILE *out = NULL;
+static bool out_set = false;
+static bool out_text = false;
+
+#define EVLOG_TAG(id, tag, format) tag,
+static const char *event_tags[EVLOG_EVENT_COUNT] = { EVLOG_EVENTS(EVLOG_TAG) };
+#undef EVLOG_TAG
+#define EVLOG_FORMAT(id, tag, format) format,
+static const char *event_formats[EVLOG_EVENT_COUNT] = { EVLOG_EVENTS(EVLOG_FORMAT) };
+#undef EVLOG_FORMAT
+
+void evlog_set_output(FILE *file, bool text)
+{
+    out = file;
+    out_set = true;
+    out_text = text;
+}
+
+void evlog_at(int64_t at_us, uint16_t id, int32_t a, int32_t b, int32_t c)
+{
+    uint32_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    do {
+        if (h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= EVLOG_RING_SIZE) {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&head, &h, h + 1, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    evlog_slot_t *slot = &ring[h % EVLOG_RING_SIZE];
+    slot->record.at_us = at_us;
+    slot->record.id = id;
+    slot->record.reserved = 0;
+    slot->record.args[0] = a;
+    slot->record.args[1] = b;
+    slot->record.args[2] = c;
+    __atomic_store_n(&slot->ready, 1, __ATOMIC_RELEASE);
+}
+
+static bool evlog_pop(evlog_record_t *r)
+{
+    evlog_slot_t *slot = &ring[tail % EVLOG_RING_SIZE];
+    if (!__atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *r = slot->record;
+    slot->ready = 0;
+    __atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void evlog_write(const evlog_record_t *r, FILE *file)
+{
+    char line[EVLOG_LINE_MAX + 160];
+    if (out_text) {
+        int len = evlog_format(r, line, sizeof(line) - 1);
+        if (len < 0) {
+            return;
+        }
+        fputs(line, file);
+        fputc('\n', file);
+    }
+    else {
+        evlog_encode(r, line);
+        fputs(line, file);
+    }
+}
+
+void evlog_drain(void)
+{
+    FILE *file = out_set ? out : stdout;
+    evlog_record_t r = { .at_us = 0 };
+    while (evlog_pop(&r)) {
+        if (file) {
+            evlog_write(&r, file);
+        }
+    }
+    uint32_t lost = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED);
+    if (lost > 0 && file) {
+        // stamped like the last record that made it
+        r = (evlog_record_t) { .at_us = r.at_us, .id = EV_DROPPED, .args = { (int32_t) lost } };
+        evlog_write(&r, file);
+    }
+}
+
+static char *put_hex(char *p, uint64_t v, int digits)
+{
+    static const char hex[] = "0123456789abcdef";
+    for (int i = digits - 1; i >= 0; i--) {
+        p[i] = hex[v & 15];
+        v >>= 4;
+    }
+    return p + digits;
+}
+
+size_t evlog_encode(const evlog_record_t *r, char *line)
+{
+    char *p = line;
+    memcpy(p, "@EV ", 4);
+    p = put_hex(p + 4, r->id, 4);
+    *p++ = ' ';
+    p = put_hex(p, (uint64_t) r->at_us, 16);
+    for (int i = 0; i < EVLOG_ARGS; i++) {
+        *p++ = ' ';
+        p = put_hex(p, (uint32_t) r->args[i], 8);
+    }
+    *p++ = '\n';
+    *p = '\0';
+    return p - line;
+}
+
+static const char *get_hex(const char *p, uint64_t *v, int digits)
+{
+    *v = 0;
+    for (int i = 0; i < digits; i++) {
+        char c = p[i];
+        int d;
+        if (c >= '0' && c <= '9') {
+            d = c - '0';
+        }
+        else if (c >= 'a' && c <= 'f') {
+            d = c - 'a' + 10;
+        }
+        else {
+            return NULL;
+        }
+        *v = (*v << 4) | d;
+    }
+    return p + digits;
+}
+
+bool evlog_decode(const char *line, evlog_record_t *r)
+{
+    // the console may have put something in front, a log prefix or noise
+    const char *p = strstr(line, "@EV ");
+    if (p == NULL) {
+        return false;
+    }
+    uint64_t v;
+    if ((p = get_hex(p + 4, &v, 4)) == NULL) {
+        return false;
+    }
+    r->id = v;
+    r->reserved = 0;
+    if (*p++ != ' ' || (p = get_hex(p, &v, 16)) == NULL) {
+        return false;
+    }
+    r->at_us = (int64_t) v;
+    for (int i = 0; i < EVLOG_ARGS; i++) {
+        if (*p++ != ' ' || (p = get_hex(p, &v, 8)) == NULL) {
+            return false;
+        }
+        r->args[i] = (int32_t) (uint32_t) v;
+    }
+    return true;
+}
+
+int evlog_format(const evlog_record_t *r, char *buf, size_t size)
+{
+    int len;
+    if (r->id >= EVLOG_EVENT_COUNT) {
+        return snprintf(buf, size, "I (%lld) evlog: unknown event %d (%d, %d, %d)",
+                        (long long) (r->at_us / 1000), r->id,
+                        (int) r->args[0], (int) r->args[1], (int) r->args[2]);
+    }
+    len = snprintf(buf, size, "I (%lld) %s: ", (long long) (r->at_us / 1000), event_tags[r->id]);
+    if (len < 0 || (size_t) len >= size) {
+        return len;
+    }
+    // the format uses as many of the args as it wants
+    int text = snprintf(&buf[len], size - len, event_formats[r->id],
+                        (int) r->args[0], (int) r->args[1], (int) r->args[2]);
+    return text < 0 ? text : len + text;
+}
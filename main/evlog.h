@@ -0,0 +1,66 @@
+/* evlog.h - deferred binary log for the hot paths
+ *
+ * evlog() costs a timestamp and a few stores: it puts a fixed size record
+ * (event id, time, three int args) into a lock-free ring, safe from any
+ * task or ISR. evlog_drain() runs in a low priority background task and
+ * writes each record out as one "@EV ..." line of hex, no printf involved.
+ * The host decoder (timesup_evlog) turns those lines back into the log
+ * lines they stand for, with the time the event happened:
+ *
+ *   idf.py monitor | ./build/host/timesup_evlog
+ *
+ * Text that isn't a record passes through untouched, so ESP_LOGx output and
+ * records can share the console.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "hal.h"
+#include "evlog_events.h"
+
+// records the ring holds, a power of two
+#define EVLOG_RING_SIZE     64
+#define EVLOG_ARGS          3
+// "@EV iiii tttttttttttttttt aaaaaaaa bbbbbbbb cccccccc\n" plus a NUL
+#define EVLOG_LINE_MAX      54
+
+#define EVLOG_ID(id, tag, format) id,
+enum {
+    EVLOG_EVENTS(EVLOG_ID)
+    EVLOG_EVENT_COUNT
+};
+#undef EVLOG_ID
+
+typedef struct {
+    int64_t at_us;
+    uint16_t id;
+    uint16_t reserved;
+    int32_t args[EVLOG_ARGS];
+} evlog_record_t;
+
+// where evlog_drain() writes: stdout (the serial console) until this is
+// called, NULL drops records. text writes evlog_format() lines instead of
+// encoded ones.
+void evlog_set_output(FILE *out, bool text);
+
+// record an event that happened at at_us
+void evlog_at(int64_t at_us, uint16_t id, int32_t a, int32_t b, int32_t c);
+
+// record an event happening now
+static inline void evlog(uint16_t id, int32_t a, int32_t b, int32_t c)
+{
+    evlog_at(hal_time_us(), id, a, b, c);
+}
+
+// write out everything recorded so far, for hal_start_background()
+void evlog_drain(void);
+
+// r as an "@EV" line (with the newline), returns its length
+size_t evlog_encode(const evlog_record_t *r, char *line);
+// parse an "@EV" line, false if line isn't one
+bool evlog_decode(const char *line, evlog_record_t *r);
+// r as the ESP_LOGI line it replaces: "I (<ms>) <tag>: <text>"
+int evlog_format(const evlog_record_t *r, char *buf, size_t size);
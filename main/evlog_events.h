@@ -0,0 +1,20 @@
+/* evlog_events.h - the events evlog() can record
+ *
+ * X(id, tag, format): format takes up to three %d, filled from the record's
+ * args. The firmware only ever stores the id; the format strings are used by
+ * evlog_format(), i.e. by the host decoder (and the host build's log).
+ * Append new events at the end so old captures still decode.
+ */
+#pragma once
+
+#define EVLOG_EVENTS(X)                                                                 \
+    X(EV_DROPPED,       "evlog",   "%d records dropped, ring full")                      \
+    X(EV_RECEIVED,      "timesup", "received %d")                                       \
+    X(EV_NEW_ANGLE,     "timesup", "new angle = %d")                                    \
+    X(EV_START_ENABLED, "timesup", "start enabled")                                     \
+    X(EV_CORRECT,       "timesup", "CORRECT INPUT")                                     \
+    X(EV_WRONG,         "timesup", "WRONG INPUT")                                       \
+    X(EV_REACTION,      "timesup", "reaction = %d us (arrow took %d us to render, %d us to send)") \
+    X(EV_SPIRAL_CLAMP,  "spiral",  "spiral index %d set to %d")                         \
+    X(EV_RANDOM,        "timesup", "random %d")                                         \
+    X(EV_EARLY,         "timesup", "received %d %d us before the arrow lit, dropped")
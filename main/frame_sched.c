@@ -0,0 +1,108 @@
+/* frame_sched.c - fixed timestep frame pacing, see frame_sched.h
+ */
+#include "esp_log.h"
+#include "hal.h"
+#include "frame_sched.h"
+
+static const char *TAG = "frame_sched";
+
+frame_stats_t frame_stats;
+
+static int64_t frame_start = 0;
+static int64_t deadline = 0;
+static int64_t transmit_start = 0;
+static int64_t transmit_acc = 0;
+
+void frame_sched_set_fps(uint32_t fps)
+{
+    frame_stats.fps = fps;
+    frame_stats.period_us = 1000000 / fps;
+    frame_start = hal_time_us();
+    deadline = frame_start + frame_stats.period_us;
+    transmit_acc = 0;
+}
+
+void frame_sched_start(uint32_t fps)
+{
+    frame_stats = (frame_stats_t) { 0 };
+    frame_sched_set_fps(fps);
+}
+
+void frame_sched_transmit_begin(void)
+{
+    transmit_start = hal_time_us();
+}
+
+void frame_sched_transmit_end(void)
+{
+    transmit_acc += hal_time_us() - transmit_start;
+}
+
+// count the frame that ends now
+static void frame_end(int64_t now)
+{
+    frame_stats.frames++;
+    frame_stats.transmit_us = transmit_acc;
+    frame_stats.render_us = now - frame_start - transmit_acc;
+    frame_stats.render_us_total += frame_stats.render_us;
+    frame_stats.transmit_us_total += frame_stats.transmit_us;
+    if (frame_stats.render_us > frame_stats.render_us_max) {
+        frame_stats.render_us_max = frame_stats.render_us;
+    }
+    if (frame_stats.transmit_us > frame_stats.transmit_us_max) {
+        frame_stats.transmit_us_max = frame_stats.transmit_us;
+    }
+}
+
+// the next frame starts now
+static void frame_begin(int64_t slept_since)
+{
+    frame_start = hal_time_us();
+    frame_stats.idle_us = frame_start - slept_since;
+    frame_stats.idle_us_total += frame_stats.idle_us;
+    transmit_acc = 0;
+}
+
+// slots of the schedule from deadline up to and including t
+static int64_t slots_until(int64_t t)
+{
+    return t < deadline ? 0 : (t - deadline) / frame_stats.period_us + 1;
+}
+
+bool frame_sched_wait_event(int64_t wake_at)
+{
+    int64_t now = hal_time_us();
+    frame_end(now);
+
+    // deadline is the next slot; a frame that wanted it but ran past
+    // skips to the next slot still ahead of us
+    int64_t slots = slots_until(now);
+    if (wake_at <= deadline) {
+        frame_stats.missed += slots;
+    }
+    deadline += slots * frame_stats.period_us;
+    if (wake_at < deadline) {
+        wake_at = deadline;
+    }
+    bool input = hal_wait_input_until_us(wake_at);
+    if (input) {
+        frame_stats.input_wakes++;
+    }
+
+    frame_begin(now);
+    // the frame starting now takes the slot it woke in, a long sleep
+    // isn't a miss
+    deadline += slots_until(frame_start) * frame_stats.period_us;
+    return input;
+}
+
+void frame_sched_log(void)
+{
+    uint32_t n = frame_stats.frames ? frame_stats.frames : 1;
+    ESP_LOGI(TAG, "%d fps target, %d frames, %d missed, avg render %d us (max %d), "
+             "transmit %d us (max %d), idle %d us",
+             (int) frame_stats.fps, (int) frame_stats.frames, (int) frame_stats.missed,
+             (int) (frame_stats.render_us_total / n), (int) frame_stats.render_us_max,
+             (int) (frame_stats.transmit_us_total / n), (int) frame_stats.transmit_us_max,
+             (int) (frame_stats.idle_us_total / n));
+}
@@ -0,0 +1,57 @@
+/* frame_sched.h - fixed timestep frame pacing and frame time counters
+ *
+ * The schedule is a grid of slots start + n * period. Each frame ends
+ * with frame_sched_wait_event(): it sleeps until the frame's own wake time
+ * or until a button press, whichever comes first. A frame that animates
+ * asks for the next frame right away (wake_at = now) and gets the next
+ * slot on the grid, so the frame rate doesn't drift with how long a frame
+ * takes or how late the wake was. A frame that runs past the slot it
+ * wanted counts every slot it skipped as missed, and the schedule goes on
+ * from the next slot ahead rather than bursting to catch up. A loop with
+ * nothing to animate sleeps until its own deadline, and the fps only caps
+ * how often that can wake it.
+ *
+ * Per frame:  ...render...  show_frame() inside frame_sched_transmit_begin()
+ *             / _end()  ...  frame_sched_wait_event(wake_at)
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint32_t fps;
+    int64_t period_us;
+    uint32_t frames;
+    uint32_t missed;            // slots skipped by frames that wanted them
+    uint32_t input_wakes;       // frame_sched_wait_event() woken by a press
+    // last frame
+    int64_t render_us;
+    int64_t transmit_us;
+    int64_t idle_us;
+    // worst frame since start
+    int64_t render_us_max;
+    int64_t transmit_us_max;
+    // sums, for averages
+    int64_t render_us_total;
+    int64_t transmit_us_total;
+    int64_t idle_us_total;
+} frame_stats_t;
+
+// readable at any time, e.g. from a debug console
+extern frame_stats_t frame_stats;
+
+// start the schedule now at fps frames per second, counters are cleared
+void frame_sched_start(uint32_t fps);
+// change the rate, the schedule restarts from now but counters are kept
+void frame_sched_set_fps(uint32_t fps);
+
+void frame_sched_transmit_begin(void);
+void frame_sched_transmit_end(void);
+// end the frame and sleep until wake_at (INT64_MAX for no deadline, never
+// sooner than the next slot) or until a button press got handled. true
+// when it was the press.
+bool frame_sched_wait_event(int64_t wake_at);
+
+// one line summary to the log
+void frame_sched_log(void);
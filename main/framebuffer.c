@@ -0,0 +1,221 @@
+/* framebuffer.c - strip buffer, mapping table and column blitters
+ */
+#include <string.h>
+#include "hal.h"
+#include "framebuffer.h"
+
+static uint8_t led_strip_buffers[2][FRAME_BYTES];
+// frame number each buffer was last sent as, 0 if never
+static uint32_t buffer_frame[2];
+static int back = 0;
+#if FRAMEBUFFER_INDEXED
+// pixels follow the buffer's own copy of the palette
+#define PIXELS_OFFSET PALETTE_BYTES
+uint8_t framebuffer_palette[PALETTE_BYTES];
+bool palette_dirty = true;
+// framebuffer_palette changes are counted, a buffer whose copy is from an
+// older version gets a fresh one when it is presented
+static uint32_t palette_version = 1;
+static uint32_t buffer_palette_version[2];
+static uint8_t palette_fixed_used = 1;
+#else
+#define PIXELS_OFFSET 0
+#endif
+uint8_t *led_strip_pixels = &led_strip_buffers[0][PIXELS_OFFSET];
+uint16_t xy_strip_table[SIZE_X * SIZE_Y];
+// everything is dirty until the first transmit
+uint16_t dirty_lo = 0;
+uint16_t dirty_hi = STRIP_LENGTH;
+// pixels outside [lit_lo, lit_hi) are known to be black
+static uint16_t lit_lo = 0;
+static uint16_t lit_hi = STRIP_LENGTH;
+uint32_t presented_frame = 0;
+
+static const geometry_tile_t geometry_tiles[TILE_COUNT] = GEOMETRY_TILES;
+
+// Assumes serpentine starting top left going down/up/down/up...
+// (x, y on an upright panel)
+static uint32_t serpentine_xy_to_strip(uint32_t x, uint32_t y)
+{
+    // flip top to bottom
+    y = PANEL_SIZE - 1 - y;
+    // if it's an even row
+    if ((x & 1) == 0) {
+        return x * PANEL_SIZE + PANEL_SIZE - 1 - y;
+    }
+    else {
+        return x * PANEL_SIZE + y;
+    }
+}
+
+// x, y as seen on a panel mounted turns quarter turns clockwise, back to
+// where that LED is on the upright panel
+static void unturn(uint32_t turns, uint32_t *x, uint32_t *y)
+{
+    const uint32_t m = PANEL_SIZE - 1;
+    uint32_t px = *x;
+    uint32_t py = *y;
+    switch (turns & 3) {
+    case 1:
+        *x = m - py;
+        *y = px;
+        break;
+    case 2:
+        *x = m - px;
+        *y = m - py;
+        break;
+    case 3:
+        *x = py;
+        *y = m - px;
+        break;
+    default:
+        break;
+    }
+}
+
+void framebuffer_setup(void)
+{
+    for (uint32_t t = 0; t < TILE_COUNT; t++) {
+        const geometry_tile_t *tile = &geometry_tiles[t];
+        for (uint32_t x = 0; x < PANEL_SIZE; x++) {
+            for (uint32_t y = 0; y < PANEL_SIZE; y++) {
+                uint32_t px = x;
+                uint32_t py = y;
+                unturn(tile->turns, &px, &py);
+                uint32_t dx = tile->tile_x * PANEL_SIZE + x;
+                uint32_t dy = tile->tile_y * PANEL_SIZE + y;
+                xy_strip_table[dx * SIZE_Y + dy] = t * PANEL_PIXELS + serpentine_xy_to_strip(px, py);
+            }
+        }
+    }
+}
+
+// anything written since the last transmit may be lit
+static void fold_dirty_into_lit(void)
+{
+    if (dirty_lo < lit_lo) {
+        lit_lo = dirty_lo;
+    }
+    if (dirty_hi > lit_hi) {
+        lit_hi = dirty_hi;
+    }
+}
+
+void framebuffer_clean(void)
+{
+    fold_dirty_into_lit();
+    dirty_lo = STRIP_LENGTH;
+    dirty_hi = 0;
+}
+
+#if FRAMEBUFFER_INDEXED
+void palette_set_grb(uint8_t entry, const uint8_t *grb)
+{
+    uint8_t *p = &framebuffer_palette[entry * 3];
+    if (p[0] != grb[0] || p[1] != grb[1] || p[2] != grb[2]) {
+        p[0] = grb[0];
+        p[1] = grb[1];
+        p[2] = grb[2];
+        if (!palette_dirty) {
+            palette_dirty = true;
+            palette_version++;
+        }
+    }
+}
+
+uint8_t palette_rgb(uint32_t red, uint32_t green, uint32_t blue)
+{
+    const uint8_t grb[3] = { green, red, blue };
+    if ((green | red | blue) == 0) {
+        return 0;
+    }
+    for (uint8_t i = 1; i < palette_fixed_used; i++) {
+        if (memcmp(&framebuffer_palette[i * 3], grb, 3) == 0) {
+            return i;
+        }
+    }
+    if (palette_fixed_used == PALETTE_FIXED) {
+        return 0;
+    }
+    palette_set_grb(palette_fixed_used, grb);
+    return palette_fixed_used++;
+}
+#endif
+
+esp_err_t framebuffer_present(void)
+{
+    uint8_t *front = led_strip_pixels;
+#if FRAMEBUFFER_INDEXED
+    if (buffer_palette_version[back] != palette_version) {
+        memcpy(led_strip_buffers[back], framebuffer_palette, PALETTE_BYTES);
+        buffer_palette_version[back] = palette_version;
+    }
+    palette_dirty = false;
+#endif
+    esp_err_t ret = hal_led_transmit(led_strip_buffers[back], FRAME_BYTES, &buffer_frame[back]);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    presented_frame = buffer_frame[back];
+    back ^= 1;
+    // normally long done, a frame takes less than a frame period to send
+    ret = hal_led_wait_frame(buffer_frame[back]);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    led_strip_pixels = &led_strip_buffers[back][PIXELS_OFFSET];
+    if (dirty_lo < dirty_hi) {
+        memcpy(&led_strip_pixels[dirty_lo * PIXEL_BYTES], &front[dirty_lo * PIXEL_BYTES],
+               (dirty_hi - dirty_lo) * PIXEL_BYTES);
+    }
+    framebuffer_clean();
+    return ESP_OK;
+}
+
+void clear_strip(void)
+{
+    fold_dirty_into_lit();
+    for (uint32_t i = lit_lo; i < lit_hi; i++) {
+        set_index_rgb(i, 0, 0, 0);
+    }
+    lit_lo = STRIP_LENGTH;
+    lit_hi = 0;
+}
+
+void fill_column_rgb(uint32_t x, uint32_t y, uint32_t len, uint32_t red, uint32_t green, uint32_t blue)
+{
+    if (len == 0) {
+        return;
+    }
+    uint32_t first = xy_to_strip(x, y);
+    uint32_t last = xy_to_strip(x, y + len - 1);
+    uint32_t start = first < last ? first : last;
+    if ((first < last ? last - first : first - last) != len - 1 ||
+        first / PANEL_PIXELS != last / PANEL_PIXELS) {
+        // column isn't one piece of strip (turned panel, or it crosses
+        // into the next one), go pixel by pixel
+        for (uint32_t j = 0; j < len; j++) {
+            set_xy_rgb(x, y + j, red, green, blue);
+        }
+        return;
+    }
+    for (uint32_t i = start; i < start + len; i++) {
+        set_index_rgb(i, red, green, blue);
+    }
+}
+
+void blit_columns_rgb(const uint16_t *columns, int size_x,
+                      int offset_x, int offset_y,
+                      uint32_t red, uint32_t green, uint32_t blue)
+{
+    for (int i = 0; i < size_x; i++) {
+        uint32_t bits = columns[i];
+        // one fill per run of set bits
+        while (bits) {
+            int start = __builtin_ctz(bits);
+            int len = __builtin_ctz(~(bits >> start));
+            fill_column_rgb(i + offset_x, start + offset_y, len, red, green, blue);
+            bits &= ~(((1u << len) - 1) << start);
+        }
+    }
+}
@@ -0,0 +1,166 @@
+/* framebuffer.h - the GRB strip buffer and the x/y -> strip mapping
+ *
+ * Pixels are kept in strip (wire) order. xy_to_strip() is a lookup into a
+ * table built once by framebuffer_setup() from the panel layout in
+ * geometry.h, stored column by column so a vertical run of pixels is a run
+ * of table entries too. Inside an upright (or upside down) serpentine
+ * panel that run is also contiguous in the strip, which fill_column_rgb()
+ * and blit_columns_rgb() use to write whole column runs at once.
+ *
+ * Writes that change a pixel widen the dirty range [dirty_lo, dirty_hi)
+ * (strip indices); writing the color a pixel already has is free. The main
+ * loop only transmits when framebuffer_dirty() says something changed.
+ *
+ * There are two buffers. led_strip_pixels is always the back one; while
+ * framebuffer_present() has the front one on the wire, drawing goes on in
+ * the back one, which present() first brings up to date by copying over
+ * just the dirty range.
+ *
+ * With FRAMEBUFFER_INDEXED set a pixel is one byte, an index into a 256
+ * entry GRB palette, and the RMT encoder expands it on the way out. Each
+ * buffer then carries its own copy of the palette in front of the pixels
+ * (PALETTE_BYTES + STRIP_LENGTH, against STRIP_LENGTH * 3 for GRB), so a
+ * palette change only reaches the frames presented after it. Changing a
+ * palette entry recolors every pixel using it without touching them. The
+ * RGB drawing calls still work, their colors get palette entries from a
+ * small shared area (palette_rgb()).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+// SIZE_X, SIZE_Y, STRIP_LENGTH
+#include "geometry.h"
+
+#ifndef FRAMEBUFFER_INDEXED
+#define FRAMEBUFFER_INDEXED 0
+#endif
+
+#define PALETTE_SIZE        256
+#define PALETTE_BYTES       (PALETTE_SIZE * 3)
+// entries palette_rgb() hands out, 0 is always black; the rest of the
+// palette is free for ramps like the spiral's
+#define PALETTE_FIXED       16
+
+#if FRAMEBUFFER_INDEXED
+#define PIXEL_BYTES         1
+#define FRAME_BYTES         (PALETTE_BYTES + STRIP_LENGTH)
+#else
+#define PIXEL_BYTES         3
+#define FRAME_BYTES         (STRIP_LENGTH * 3)
+#endif
+
+extern uint8_t *led_strip_pixels;
+extern uint16_t xy_strip_table[SIZE_X * SIZE_Y];
+extern uint16_t dirty_lo;
+extern uint16_t dirty_hi;
+// hal frame number of the last framebuffer_present(), 0 before the first
+extern uint32_t presented_frame;
+#if FRAMEBUFFER_INDEXED
+// the palette being drawn with, GRB per entry
+extern uint8_t framebuffer_palette[PALETTE_BYTES];
+extern bool palette_dirty;
+#endif
+
+// build xy_strip_table, call before drawing anything
+void framebuffer_setup(void);
+
+// anything changed since the last framebuffer_clean()?
+static inline int framebuffer_dirty(void)
+{
+#if FRAMEBUFFER_INDEXED
+    if (palette_dirty) {
+        return 1;
+    }
+#endif
+    return dirty_lo < dirty_hi;
+}
+
+// the current contents are on the wire
+void framebuffer_clean(void);
+
+// send the back buffer and swap, drawing can go on right away
+esp_err_t framebuffer_present(void);
+
+static inline void mark_dirty(uint32_t index)
+{
+    if (index < dirty_lo) {
+        dirty_lo = index;
+    }
+    if (index >= dirty_hi) {
+        dirty_hi = index + 1;
+    }
+}
+
+// blank every pixel, only the lit ones are touched
+void clear_strip(void);
+
+// map x, y to led strip #, x/y start from 0,0 at bottom left
+static inline uint32_t xy_to_strip(uint32_t x, uint32_t y)
+{
+    return xy_strip_table[x * SIZE_Y + y];
+}
+
+#if FRAMEBUFFER_INDEXED
+// set palette entry (GRB), every pixel using it changes color
+void palette_set_grb(uint8_t entry, const uint8_t *grb);
+// the PALETTE_FIXED entry holding this color, allocated on first use;
+// 0 (black) once they are all taken
+uint8_t palette_rgb(uint32_t red, uint32_t green, uint32_t blue);
+
+static inline void set_index_color(uint32_t index, uint8_t color)
+{
+    if (led_strip_pixels[index] != color) {
+        led_strip_pixels[index] = color;
+        mark_dirty(index);
+    }
+}
+
+static inline void set_index_rgb(uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    set_index_color(index, palette_rgb(red, green, blue));
+}
+
+static inline void set_index_grb(uint32_t index, const uint8_t *grb)
+{
+    set_index_color(index, palette_rgb(grb[1], grb[0], grb[2]));
+}
+#else
+static inline void set_index_rgb(uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    uint8_t *p = &led_strip_pixels[index * 3];
+    if (p[0] != (uint8_t) green || p[1] != (uint8_t) red || p[2] != (uint8_t) blue) {
+        p[0] = green;
+        p[1] = red;
+        p[2] = blue;
+        mark_dirty(index);
+    }
+}
+
+// same with the color already in strip (GRB) byte order
+static inline void set_index_grb(uint32_t index, const uint8_t *grb)
+{
+    uint8_t *p = &led_strip_pixels[index * 3];
+    if (p[0] != grb[0] || p[1] != grb[1] || p[2] != grb[2]) {
+        p[0] = grb[0];
+        p[1] = grb[1];
+        p[2] = grb[2];
+        mark_dirty(index);
+    }
+}
+#endif
+
+static inline void set_xy_rgb(uint32_t x, uint32_t y, uint32_t red, uint32_t green, uint32_t blue)
+{
+    set_index_rgb(xy_to_strip(x, y), red, green, blue);
+}
+
+// fill len pixels of column x going up from y
+void fill_column_rgb(uint32_t x, uint32_t y, uint32_t len, uint32_t red, uint32_t green, uint32_t blue);
+
+// draw a column-major bitmap (one word per column, bit j = row j) of size_x
+// columns with its bottom left corner at offset_x, offset_y
+void blit_columns_rgb(const uint16_t *columns, int size_x,
+                      int offset_x, int offset_y,
+                      uint32_t red, uint32_t green, uint32_t blue);
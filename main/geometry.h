@@ -0,0 +1,68 @@
+/* geometry.h - how the display is built out of LED panels
+ *
+ * The display is a grid of TILES_X by TILES_Y square panels, PANEL_SIZE
+ * LEDs a side, all chained on one data line. GEOMETRY_TILES lists the
+ * panels in wiring order, each as { tile_x, tile_y, turns }: where it sits
+ * in the grid (0,0 bottom left, like pixels) and how many quarter turns
+ * clockwise it is mounted from upright. Inside a panel the LEDs run in the
+ * serpentine order of the original single panel. framebuffer_setup() turns
+ * this into xy_strip_table, and everything else (spiral, glyph and HUD
+ * placement) follows SIZE_X and SIZE_Y.
+ *
+ * LED_CHANNELS splits the chain into that many runs of whole panels, each
+ * on its own data line and sent at the same time (see hal_led_init()).
+ *
+ * Pick a layout at build time with -DGEOMETRY=<one of the ids below>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define GEOMETRY_16X16      0   // one panel
+#define GEOMETRY_32X32      1   // 2x2, bottom row upside down
+#define GEOMETRY_64X16      2   // 4 in a row
+
+#ifndef GEOMETRY
+#define GEOMETRY GEOMETRY_16X16
+#endif
+
+#define PANEL_SIZE          16
+#define PANEL_PIXELS        (PANEL_SIZE * PANEL_SIZE)
+
+#if GEOMETRY == GEOMETRY_16X16
+#define TILES_X             1
+#define TILES_Y             1
+#define GEOMETRY_TILES      { { 0, 0, 0 } }
+#define GEOMETRY_CHANNELS   1
+#elif GEOMETRY == GEOMETRY_32X32
+// wired across the top left to right, then back along the bottom with
+// those two panels turned round so the chain stays short
+#define TILES_X             2
+#define TILES_Y             2
+#define GEOMETRY_TILES      { { 0, 1, 0 }, { 1, 1, 0 }, { 1, 0, 2 }, { 0, 0, 2 } }
+#define GEOMETRY_CHANNELS   2
+#elif GEOMETRY == GEOMETRY_64X16
+#define TILES_X             4
+#define TILES_Y             1
+#define GEOMETRY_TILES      { { 0, 0, 0 }, { 1, 0, 0 }, { 2, 0, 0 }, { 3, 0, 0 } }
+#define GEOMETRY_CHANNELS   2
+#else
+#error "unknown GEOMETRY"
+#endif
+
+#define TILE_COUNT          (TILES_X * TILES_Y)
+#define SIZE_X              (TILES_X * PANEL_SIZE)
+#define SIZE_Y              (TILES_Y * PANEL_SIZE)
+#define STRIP_LENGTH        (SIZE_X * SIZE_Y)
+
+// the chain's parallel outputs, 2 is what the ESP32-C3's RMT can do
+#ifndef LED_CHANNELS
+#define LED_CHANNELS        GEOMETRY_CHANNELS
+#endif
+_Static_assert(TILE_COUNT % LED_CHANNELS == 0, "LED_CHANNELS must split the panels evenly");
+
+typedef struct {
+    uint8_t tile_x;
+    uint8_t tile_y;
+    uint8_t turns;      // quarter turns clockwise
+} geometry_tile_t;
@@ -0,0 +1,88 @@
+/* hal.h - the hardware the game loop talks to
+ *
+ * timesup_main.c only reaches the LEDs, the buttons, the clock and the RNG
+ * through these calls. hal_esp.c implements them on the board (RMT, GPIO,
+ * esp_timer, esp_random), host/hal_host.c with Linux stand-ins so the same
+ * loop can run under perf/valgrind or in CI.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "input_events.h"
+
+// game input GPIOs
+#define GPIO_UP 3
+#define GPIO_DOWN 0
+#define GPIO_LEFT 10
+#define GPIO_RIGHT 1
+
+// completion times kept by hal_led_frame_done_us(), a power of two
+#define HAL_LED_FRAME_HISTORY 16
+
+// called once per accepted button press from task context (never from the
+// ISR), event->at_us is when the ISR saw it
+typedef void (*hal_input_handler_t)(const input_event_t *event);
+
+// GRB palette in front of indexed frames, see hal_led_init()
+#define HAL_LED_PALETTE_BYTES (256 * 3)
+// most outputs a strip can be split over
+#define HAL_LED_MAX_CHANNELS 4
+
+typedef struct {
+    size_t pixels;          // LEDs in all, every frame is this long
+    uint32_t channels;      // outputs (RMT channel + GPIO each), 1..HAL_LED_MAX_CHANNELS
+    bool indexed;           // frames are palette + indices, not GRB
+} hal_led_config_t;
+
+// set up the LED output (RMT channels + strip encoders). The strip is cut
+// into config->channels runs (hal_led_segment()), each driven from its own
+// GPIO; the runs of a frame start together and the frame is done when the
+// last one is, so a frame takes the wire time of one run. With indexed set,
+// every transmitted buffer is a HAL_LED_PALETTE_BYTES GRB palette followed
+// by one palette index per pixel instead of GRB per pixel.
+esp_err_t hal_led_init(const hal_led_config_t *config);
+
+// the run of pixels channel k of channels sends: in strip order, as even as
+// possible with the longer runs first
+static inline void hal_led_segment(size_t pixels, uint32_t channels, uint32_t k,
+                                   size_t *first, size_t *count)
+{
+    size_t base = pixels / channels;
+    size_t extra = pixels % channels;
+    *first = k * base + (k < extra ? k : extra);
+    *count = base + (k < extra ? 1 : 0);
+}
+
+// start pushing a GRB buffer out to the strip, returns once it is queued.
+// Frames are numbered from 1 in transmit order; the buffer must stay
+// untouched until hal_led_wait_frame(*frame) returns.
+esp_err_t hal_led_transmit(const uint8_t *pixels, size_t size, uint32_t *frame);
+// wait until frame (and every frame before it) is completely on the wire
+esp_err_t hal_led_wait_frame(uint32_t frame);
+// hal_time_us() when the last bit of frame left, i.e. when the LEDs latched
+// it. 0 if it is still pending or older than HAL_LED_FRAME_HISTORY frames.
+int64_t hal_led_frame_done_us(uint32_t frame);
+
+// enable falling edge interrupts on pins, presses are handed to handler
+esp_err_t hal_input_init(const uint32_t *pins, size_t count, hal_input_handler_t handler);
+// while disarmed the ISR drops presses without waking anyone
+void hal_input_arm(bool armed);
+void hal_input_set_debounce_us(uint32_t gpio_num, uint32_t us);
+const input_stats_t *hal_input_stats(void);
+
+// microseconds since boot
+int64_t hal_time_us(void);
+// block the calling task until hal_time_us() reaches t, to the microsecond,
+// or return (true) as soon as the input handler has run. A press handled
+// while the caller was busy elsewhere returns right away. t == INT64_MAX
+// waits for input only.
+bool hal_wait_input_until_us(int64_t t);
+uint32_t hal_random(void);
+// run work over and over at low priority, below the game and input tasks,
+// whenever they are idle. work returns when it has nothing left to do.
+esp_err_t hal_start_background(void (*work)(void));
+// 0 once the main loop should return (never on the board)
+int hal_running(void);
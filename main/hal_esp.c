@@ -0,0 +1,333 @@
+/* hal_esp.c - hal.h on the ESP32-C3 board
+ *
+ * LED strip on one or more RMT channels, buttons on GPIO interrupts feeding a lock-free ring.
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "driver/rmt_tx.h"
+#include "driver/gpio.h"
+#include "soc/soc_caps.h"
+#include "led_strip_encoder.h"
+#include "hal.h"
+
+#define RMT_LED_STRIP_RESOLUTION_HZ 10000000 // 10MHz resolution, 1 tick = 0.1us (led strip needs a high resolution)
+// data line of each LED channel, the first one is the original strip pin
+static const gpio_num_t led_gpio[HAL_LED_MAX_CHANNELS] = { 2, 4, 5, 6 };
+
+static const char *TAG = "hal";
+
+static hal_led_config_t led_config;
+static rmt_channel_handle_t led_chan[HAL_LED_MAX_CHANNELS];
+static rmt_encoder_handle_t led_encoder[HAL_LED_MAX_CHANNELS];
+static rmt_sync_manager_handle_t led_sync = NULL;
+// each channel's run of the strip, in pixels
+static size_t segment_first[HAL_LED_MAX_CHANNELS];
+static size_t segment_count[HAL_LED_MAX_CHANNELS];
+static rmt_transmit_config_t tx_config = {
+    .loop_count = 0, // no transfer loop
+};
+// frames handed to the RMT driver / completed, counted from 1
+static uint32_t frames_queued = 0;
+static volatile uint32_t frames_done = 0;
+// frames each channel has finished its run of
+static volatile uint32_t channel_done[HAL_LED_MAX_CHANNELS];
+static volatile int64_t frame_done_at[HAL_LED_FRAME_HISTORY];
+static SemaphoreHandle_t frame_done_sem = NULL;
+
+// one channel's run is out, runs in the RMT ISR. The frame is done once
+// the slowest channel has sent its run.
+static bool IRAM_ATTR led_tx_done(rmt_channel_handle_t chan, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    uint32_t k = (uint32_t) user_ctx;
+    channel_done[k]++;
+    uint32_t done = channel_done[0];
+    for (uint32_t c = 1; c < led_config.channels; c++) {
+        if ((int32_t) (channel_done[c] - done) < 0) {
+            done = channel_done[c];
+        }
+    }
+    if (done == frames_done) {
+        return false;
+    }
+    BaseType_t woken = pdFALSE;
+    // stamp first, frames_done publishes it
+    frame_done_at[done % HAL_LED_FRAME_HISTORY] = esp_timer_get_time();
+    frames_done = done;
+    xSemaphoreGiveFromISR(frame_done_sem, &woken);
+    return woken == pdTRUE;
+}
+
+esp_err_t hal_led_init(const hal_led_config_t *config)
+{
+    if (config->channels < 1 || config->channels > HAL_LED_MAX_CHANNELS ||
+        config->channels > SOC_RMT_TX_CANDIDATES_PER_GROUP) {
+        ESP_LOGE(TAG, "%d LED channels, this chip has %d", (int) config->channels, SOC_RMT_TX_CANDIDATES_PER_GROUP);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#ifndef LED_STRIP_ENCODER_HAS_LUT
+    if (config->indexed) {
+        ESP_LOGE(TAG, "indexed frames need the LUT encoder (ESP-IDF 5.3)");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+    led_config = *config;
+
+    frame_done_sem = xSemaphoreCreateBinary();
+    if (frame_done_sem == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t k = 0; k < config->channels; k++) {
+        hal_led_segment(config->pixels, config->channels, k, &segment_first[k], &segment_count[k]);
+        ESP_LOGI(TAG, "Create RMT TX channel %d on GPIO %d, pixels %d..%d", (int) k, led_gpio[k],
+                 (int) segment_first[k], (int) (segment_first[k] + segment_count[k] - 1));
+        rmt_tx_channel_config_t tx_chan_config = {
+            .clk_src = RMT_CLK_SRC_DEFAULT, // select source clock
+            .gpio_num = led_gpio[k],
+            .mem_block_symbols = 64, // increase the block size can make the LED less flickering
+            .resolution_hz = RMT_LED_STRIP_RESOLUTION_HZ,
+            .trans_queue_depth = 4, // set the number of transactions that can be pending in the background
+        };
+        ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &led_chan[k]));
+
+        led_strip_encoder_config_t encoder_config = {
+            .resolution = RMT_LED_STRIP_RESOLUTION_HZ,
+#ifdef LED_STRIP_ENCODER_HAS_LUT
+            .use_lut = true, // colors go out as is, no channel_lut
+            .palette = config->indexed,
+            .first_pixel = segment_first[k],
+#endif
+        };
+        ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&encoder_config, &led_encoder[k]));
+
+        rmt_tx_event_callbacks_t callbacks = {
+            .on_trans_done = led_tx_done,
+        };
+        ESP_ERROR_CHECK(rmt_tx_register_event_callbacks(led_chan[k], &callbacks, (void *) k));
+        ESP_ERROR_CHECK(rmt_enable(led_chan[k]));
+    }
+    if (config->channels > 1) {
+        // the runs of a frame start on the same tick
+        rmt_sync_manager_config_t sync_config = {
+            .tx_channel_array = led_chan,
+            .array_size = config->channels,
+        };
+        ESP_ERROR_CHECK(rmt_new_sync_manager(&sync_config, &led_sync));
+    }
+    return ESP_OK;
+}
+
+esp_err_t hal_led_transmit(const uint8_t *pixels, size_t size, uint32_t *frame)
+{
+    size_t header = led_config.indexed ? HAL_LED_PALETTE_BYTES : 0;
+    size_t pixel_bytes = led_config.indexed ? 1 : 3;
+    if (size != header + led_config.pixels * pixel_bytes) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (uint32_t k = 0; k < led_config.channels; k++) {
+        // blocks only if trans_queue_depth frames are already pending
+        esp_err_t ret;
+        if (led_config.indexed) {
+            // the encoder skips to its run itself, the palette is shared
+            ret = rmt_transmit(led_chan[k], led_encoder[k], pixels,
+                               header + segment_first[k] + segment_count[k], &tx_config);
+        }
+        else {
+            ret = rmt_transmit(led_chan[k], led_encoder[k], pixels + segment_first[k] * 3,
+                               segment_count[k] * 3, &tx_config);
+        }
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    *frame = ++frames_queued;
+    return ESP_OK;
+}
+
+esp_err_t hal_led_wait_frame(uint32_t frame)
+{
+    // frames finish in order, so the counter says it all
+    while ((int32_t) (frames_done - frame) < 0) {
+        xSemaphoreTake(frame_done_sem, portMAX_DELAY);
+    }
+    return ESP_OK;
+}
+
+int64_t hal_led_frame_done_us(uint32_t frame)
+{
+    uint32_t age = frames_done - frame;
+    if ((int32_t) age < 0 || age >= HAL_LED_FRAME_HISTORY - 1) {
+        return 0;
+    }
+    return frame_done_at[frame % HAL_LED_FRAME_HISTORY];
+}
+
+// what woke the main task, as task notification bits
+#define WAKE_TIMER  (1 << 0)
+#define WAKE_INPUT  (1 << 1)
+
+// the task sleeping in hal_wait_input_until_us(),
+// only ever the main task
+static TaskHandle_t main_task = NULL;
+
+// presses from the ISR to gpio_task
+static input_ring_t input_ring;
+static input_filter_t input_filter;
+static TaskHandle_t gpio_task_handle = NULL;
+static hal_input_handler_t input_handler = NULL;
+
+// ISR handler needs to be short and sweet: stamp, filter, push, wake
+static void IRAM_ATTR gpio_isr_handler(void* arg) {
+    input_event_t event = {
+        .gpio_num = (uint32_t) arg,
+        .edge = INPUT_EDGE_FALLING,
+        .at_us = esp_timer_get_time(),
+    };
+    if (!input_filter_accept(&input_filter, event.gpio_num, event.at_us)) {
+        return;
+    }
+    if (input_ring_push(&input_ring, &input_filter.stats, &event)) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(gpio_task_handle, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+// hand events from the ring to the game
+static void gpio_task(void* arg) {
+    input_event_t event;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        bool handled = false;
+        while (input_ring_pop(&input_ring, &event)) {
+            input_handler(&event);
+            handled = true;
+        }
+        if (handled && main_task != NULL) {
+            xTaskNotify(main_task, WAKE_INPUT, eSetBits);
+        }
+    }
+}
+
+esp_err_t hal_input_init(const uint32_t *pins, size_t count, hal_input_handler_t handler)
+{
+    ESP_LOGI(TAG, "enable GPIO inputs");
+    for (size_t i = 0; i < count; i++) {
+        gpio_pullup_en(pins[i]);
+        gpio_set_direction(pins[i], GPIO_MODE_INPUT);
+        gpio_set_intr_type(pins[i], GPIO_INTR_NEGEDGE);
+        gpio_intr_enable(pins[i]);
+    }
+
+    ESP_LOGI(TAG, "add GPIO isr service");
+    input_handler = handler;
+    input_filter_init(&input_filter);
+    //start gpio task
+    xTaskCreate(gpio_task, "gpio_task", 2048, NULL, 10, &gpio_task_handle);
+
+    //install gpio isr service
+    ESP_ERROR_CHECK(gpio_install_isr_service(0)); // no ESP_INTR_FLAG_* needed
+    //hook isr handler for specific gpio pins
+    for (size_t i = 0; i < count; i++) {
+        gpio_isr_handler_add(pins[i], gpio_isr_handler, (void*) (uintptr_t) pins[i]);
+    }
+    return ESP_OK;
+}
+
+void hal_input_arm(bool armed)
+{
+    input_filter.armed = armed;
+}
+
+void hal_input_set_debounce_us(uint32_t gpio_num, uint32_t us)
+{
+    if (gpio_num < INPUT_MAX_GPIO) {
+        input_filter.debounce_us[gpio_num] = us;
+    }
+}
+
+const input_stats_t *hal_input_stats(void)
+{
+    return &input_filter.stats;
+}
+
+int64_t hal_time_us(void)
+{
+    return esp_timer_get_time();
+}
+
+// a tick is 10ms, too coarse for frame deadlines, so sleep on a one-shot
+// esp_timer that notifies the waiting task
+static esp_timer_handle_t wake_timer = NULL;
+
+static void wake_timer_cb(void *arg)
+{
+    xTaskNotify((TaskHandle_t) arg, WAKE_TIMER, eSetBits);
+}
+
+bool hal_wait_input_until_us(int64_t t)
+{
+    if (wake_timer == NULL) {
+        main_task = xTaskGetCurrentTaskHandle();
+        esp_timer_create_args_t args = {
+            .callback = wake_timer_cb,
+            .arg = main_task,
+            .name = "frame_wake",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &wake_timer));
+    }
+    int64_t wait = t - esp_timer_get_time();
+    if (wait <= 0) {
+        return false;
+    }
+    if (t != INT64_MAX) {
+        ESP_ERROR_CHECK(esp_timer_start_once(wake_timer, wait));
+    }
+    bool input = false;
+    while (esp_timer_get_time() < t) {
+        // a WAKE_TIMER left over from an earlier wait just goes round again
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        if (bits & WAKE_INPUT) {
+            input = true;
+            break;
+        }
+    }
+    if (t != INT64_MAX) {
+        esp_timer_stop(wake_timer); // fine if it already fired
+    }
+    return input;
+}
+
+static void (*background_work)(void) = NULL;
+
+static void background_task(void *arg)
+{
+    for (;;) {
+        background_work();
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+}
+
+esp_err_t hal_start_background(void (*work)(void))
+{
+    background_work = work;
+    // just above idle, so it only ever gets the time nobody else wants
+    if (xTaskCreate(background_task, "background", 3072, NULL, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+uint32_t hal_random(void)
+{
+    return esp_random();
+}
+
+int hal_running(void)
+{
+    return 1;
+}
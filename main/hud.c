@@ -0,0 +1,97 @@
+/* hud.c - cached HUD numbers, see hud.h
+ */
+#include <string.h>
+#include "hud.h"
+#include "digits_4x6.h"
+#include "digits_5x6.h"
+
+static const uint16_t *digit_columns(text_font_t font, int digit)
+{
+    return font == TEXT_FONT_5X6 ? digits_5x6[digit] : digits_4x6[digit];
+}
+
+static int digit_width(text_font_t font)
+{
+    return font == TEXT_FONT_5X6 ? DIGITS_5X6_WIDTH : DIGITS_4X6_WIDTH;
+}
+
+void hud_number_init(hud_number_t *n, layer_id_t layer, text_font_t font,
+                     int x, int y, int width, int min_digits,
+                     const uint8_t (*colors)[3], int color_count)
+{
+    memset(n, 0, sizeof(*n));
+    n->layer = layer;
+    n->font = font;
+    n->x = x;
+    n->y = y;
+    n->width = width;
+    n->min_digits = min_digits < 1 ? 1 : min_digits;
+    for (int k = 0; k < HUD_MAX_DIGITS; k++) {
+        memcpy(n->colors[k], colors[k < color_count ? k : color_count - 1], 3);
+    }
+}
+
+void hud_number_forget(hud_number_t *n)
+{
+    n->drawn = false;
+}
+
+static void blit_digit(const hud_number_t *n, int i, int digit)
+{
+    const uint8_t *rgb = n->colors[n->count - 1 - i];
+    layer_blit_columns_rgb(n->layer, digit_columns(n->font, digit), digit_width(n->font), TEXT_HEIGHT,
+                           n->x + n->left + i * n->pitch, n->y, rgb[0], rgb[1], rgb[2]);
+}
+
+void hud_number_set(hud_number_t *n, uint32_t value)
+{
+    if (n->drawn && value == n->value) {
+        return;
+    }
+    int w = digit_width(n->font);
+    int fit = n->width / w;
+    if (fit > HUD_MAX_DIGITS) {
+        fit = HUD_MAX_DIGITS;
+    }
+    uint8_t digits[HUD_MAX_DIGITS];
+    int count = 0;
+    for (uint32_t v = value; count < fit && (v > 0 || count < n->min_digits); v /= 10) {
+        digits[HUD_MAX_DIGITS - 1 - count++] = v % 10;
+    }
+    if (count == fit) {
+        uint32_t max = 1;
+        for (int k = 0; k < fit; k++) {
+            max *= 10;
+        }
+        if (value >= max) {
+            // doesn't fit
+            memset(&digits[HUD_MAX_DIGITS - count], 9, count);
+        }
+    }
+    const uint8_t *shown = &digits[HUD_MAX_DIGITS - count];
+
+    if (n->drawn && count == n->count) {
+        // same layout, only the digits that differ
+        for (int i = 0; i < count; i++) {
+            if (shown[i] != n->digits[i]) {
+                blit_digit(n, i, shown[i]);
+                n->digits[i] = shown[i];
+            }
+        }
+        n->value = value;
+        return;
+    }
+
+    // new layout: blank the box, then every digit
+    static const uint16_t blank[SIZE_X];
+    layer_blit_columns_rgb(n->layer, blank, n->width, TEXT_HEIGHT, n->x, n->y, 0, 0, 0);
+    n->pitch = count * (w + 1) - 1 <= n->width ? w + 1 : w;
+    n->left = (n->width - (count - 1) * n->pitch - w) / 2;
+    n->count = count;
+    for (int i = 0; i < count; i++) {
+        blit_digit(n, i, shown[i]);
+        n->digits[i] = shown[i];
+    }
+    n->value = value;
+    n->drawn = true;
+}
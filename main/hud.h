@@ -0,0 +1,49 @@
+/* hud.h - numbers in a box of a layer, redrawn digit by digit
+ *
+ * A HUD number remembers the digits it put on its layer. Setting the value
+ * it already shows costs a compare; a new value only blits the digit cells
+ * that changed, so a score going from 12 to 13 touches one 5x6 cell and
+ * the frame's merge and transmit only see those pixels.
+ *
+ * Layout is automatic: the digits (at least min_digits, zero padded) are
+ * centered in the box one column apart, or touching once that doesn't fit
+ * any more, so a 16 wide box takes three 5x6 digits or four 4x6 ones. A
+ * value with more digits than fit shows as all nines. A change in the
+ * number of digits moves them all and redraws the whole box.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "compositor.h"
+#include "text.h"
+
+#define HUD_MAX_DIGITS 8
+
+typedef struct {
+    layer_id_t layer;
+    text_font_t font;
+    int x;              // the box on the display, bottom left corner
+    int y;
+    int width;
+    int min_digits;
+    uint8_t colors[HUD_MAX_DIGITS][3];  // RGB, ones digit first
+    // what is on the layer
+    bool drawn;         // false: the box holds anything, redraw all of it
+    uint32_t value;
+    int count;          // digits
+    int left;           // first digit's column in the box
+    int pitch;          // columns from one digit to the next
+    uint8_t digits[HUD_MAX_DIGITS];     // leftmost first
+} hud_number_t;
+
+// a number in the width columns from x, y up of layer (on the display),
+// nothing drawn yet. colors are RGB triples for the ones, tens, ...
+// digit; digits past color_count take the last one.
+void hud_number_init(hud_number_t *n, layer_id_t layer, text_font_t font,
+                     int x, int y, int width, int min_digits,
+                     const uint8_t (*colors)[3], int color_count);
+// show value, drawing only what changed since the last call
+void hud_number_set(hud_number_t *n, uint32_t value);
+// something else drew over the box, the next hud_number_set() redraws it
+void hud_number_forget(hud_number_t *n);
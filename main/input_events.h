@@ -0,0 +1,104 @@
+/* input_events.h - button events from the GPIO ISR to a task
+ *
+ * The ISR stamps each edge with the time it happened, runs it through
+ * input_filter_accept() and pushes what survives into an input_ring_t.
+ * The ring is single producer (the ISR) / single consumer (the input task)
+ * and lock-free: head is only written by the producer, tail only by the
+ * consumer. Everything is inline so it lands in the ISR's IRAM.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// GPIO numbers the filter keeps state for
+#define INPUT_MAX_GPIO          32
+// must be a power of two
+#define INPUT_RING_SIZE         16
+#define INPUT_DEBOUNCE_US       20000
+
+enum {
+    INPUT_EDGE_FALLING = 0,
+    INPUT_EDGE_RISING = 1,
+};
+
+typedef struct {
+    uint32_t gpio_num;
+    uint32_t edge;
+    int64_t at_us;      // hal_time_us() when the ISR saw the edge
+} input_event_t;
+
+typedef struct {
+    uint32_t accepted;  // pushed into the ring
+    uint32_t bounced;   // inside the debounce window of the pin
+    uint32_t disarmed;  // nobody was waiting for input
+    uint32_t overflowed; // ring was full
+} input_stats_t;
+
+typedef struct {
+    input_event_t events[INPUT_RING_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} input_ring_t;
+
+typedef struct {
+    volatile bool armed;
+    uint32_t debounce_us[INPUT_MAX_GPIO];
+    int64_t last_at[INPUT_MAX_GPIO];
+    input_stats_t stats;
+} input_filter_t;
+
+static inline void input_filter_init(input_filter_t *filter)
+{
+    filter->armed = false;
+    for (int i = 0; i < INPUT_MAX_GPIO; i++) {
+        filter->debounce_us[i] = INPUT_DEBOUNCE_US;
+        filter->last_at[i] = INT64_MIN / 2;
+    }
+    filter->stats = (input_stats_t) { 0 };
+}
+
+// false for edges within the pin's debounce window of the last one, and
+// for everything while disarmed. Bounces restart the window, so a pin has
+// to be quiet for debounce_us before it counts again.
+static inline bool input_filter_accept(input_filter_t *filter, uint32_t gpio_num, int64_t at_us)
+{
+    if (gpio_num >= INPUT_MAX_GPIO) {
+        return false;
+    }
+    int64_t since = at_us - filter->last_at[gpio_num];
+    filter->last_at[gpio_num] = at_us;
+    if (since < filter->debounce_us[gpio_num]) {
+        filter->stats.bounced++;
+        return false;
+    }
+    if (!filter->armed) {
+        filter->stats.disarmed++;
+        return false;
+    }
+    return true;
+}
+
+static inline bool input_ring_push(input_ring_t *ring, input_stats_t *stats, const input_event_t *event)
+{
+    uint32_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == INPUT_RING_SIZE) {
+        stats->overflowed++;
+        return false;
+    }
+    ring->events[head & (INPUT_RING_SIZE - 1)] = *event;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    stats->accepted++;
+    return true;
+}
+
+static inline bool input_ring_pop(input_ring_t *ring, input_event_t *event)
+{
+    uint32_t tail = ring->tail;
+    if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail) {
+        return false;
+    }
+    *event = ring->events[tail & (INPUT_RING_SIZE - 1)];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
@@ -4,19 +4,150 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
 #include "esp_check.h"
 #include "led_strip_encoder.h"
 
 static const char *TAG = "led_encoder";
 
+// the 8 RMT symbols of a byte value, MSB first
+typedef rmt_symbol_word_t byte_symbols_t[8];
+
 typedef struct {
     rmt_encoder_t base;
     rmt_encoder_t *bytes_encoder;
     rmt_encoder_t *copy_encoder;
+    rmt_encoder_t *lut_encoder;       // LUT mode: simple encoder running rmt_encode_led_strip_lut()
     int state;
     rmt_symbol_word_t reset_code;
+    byte_symbols_t *byte_symbols;     // LUT mode: symbols for each byte value, see acquire_byte_symbols()
+    const uint8_t *channel_lut[3];    // LUT mode: per channel brightness/gamma, identity if not given
+    uint8_t identity_lut[256];
+    uint32_t first_pixel;             // palette mode: pixels of the data that aren't ours
 } rmt_led_strip_encoder_t;
 
+// The symbol table is 8 KB and only depends on the bit timing, so the
+// encoders of all channels share one copy, freed with the last of them.
+// Encoders are created and deleted from one task, no locking.
+static byte_symbols_t *shared_symbols = NULL;
+static int shared_symbols_users = 0;
+
+static void release_byte_symbols(byte_symbols_t *table)
+{
+    if (table == shared_symbols && table) {
+        if (--shared_symbols_users > 0) {
+            return;
+        }
+        shared_symbols = NULL;
+    }
+    free(table);
+}
+
+#ifdef LED_STRIP_ENCODER_HAS_LUT
+// the bit timing shared_symbols was built for
+static rmt_symbol_word_t shared_bit0, shared_bit1;
+
+static byte_symbols_t *acquire_byte_symbols(rmt_symbol_word_t bit0, rmt_symbol_word_t bit1)
+{
+    if (shared_symbols && shared_bit0.val == bit0.val && shared_bit1.val == bit1.val) {
+        shared_symbols_users++;
+        return shared_symbols;
+    }
+    byte_symbols_t *table = calloc(256, sizeof(table[0]));
+    if (!table) {
+        return NULL;
+    }
+    for (int value = 0; value < 256; value++) {
+        for (int bit = 0; bit < 8; bit++) {
+            // WS2812 is MSB first
+            table[value][bit] = (value & (0x80 >> bit)) ? bit1 : bit0;
+        }
+    }
+    // the first table is the shared one, a different timing after that
+    // keeps its own
+    if (!shared_symbols) {
+        shared_symbols = table;
+        shared_bit0 = bit0;
+        shared_bit1 = bit1;
+        shared_symbols_users = 1;
+    }
+    return table;
+}
+
+// Simple encoder callback: copy 8 prebuilt symbols per byte straight into
+// the RMT memory, mapping each byte through its channel's table on the way.
+// symbols_written counts from the start of the frame, so it gives the byte
+// (and channel) to continue from after a refill.
+static size_t rmt_encode_led_strip_lut(const void *data, size_t data_size,
+                                       size_t symbols_written, size_t symbols_free,
+                                       rmt_symbol_word_t *symbols, bool *done, void *arg)
+{
+    rmt_led_strip_encoder_t *led_encoder = arg;
+    const uint8_t *bytes = data;
+    size_t pos = symbols_written / 8;
+    if (pos >= data_size) {
+        if (symbols_free < 1) {
+            return 0;
+        }
+        symbols[0] = led_encoder->reset_code;
+        *done = true;
+        return 1;
+    }
+    size_t count = symbols_free / 8;
+    if (count > data_size - pos) {
+        count = data_size - pos;
+    }
+    int channel = pos % 3;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t value = led_encoder->channel_lut[channel][bytes[pos + i]];
+        memcpy(&symbols[i * 8], led_encoder->byte_symbols[value], sizeof(led_encoder->byte_symbols[0]));
+        channel = channel == 2 ? 0 : channel + 1;
+    }
+    return count * 8;
+}
+
+// Same for palette mode: the wire byte at pos is channel pos % 3 of the
+// palette entry of pixel pos / 3, counting from first_pixel.
+static size_t rmt_encode_led_strip_palette(const void *data, size_t data_size,
+                                           size_t symbols_written, size_t symbols_free,
+                                           rmt_symbol_word_t *symbols, bool *done, void *arg)
+{
+    rmt_led_strip_encoder_t *led_encoder = arg;
+    const uint8_t *palette = data;
+    const uint8_t *pixels = palette + LED_STRIP_PALETTE_BYTES + led_encoder->first_pixel;
+    size_t wire_size = (data_size - LED_STRIP_PALETTE_BYTES - led_encoder->first_pixel) * 3;
+    size_t pos = symbols_written / 8;
+    if (pos >= wire_size) {
+        if (symbols_free < 1) {
+            return 0;
+        }
+        symbols[0] = led_encoder->reset_code;
+        *done = true;
+        return 1;
+    }
+    size_t count = symbols_free / 8;
+    if (count > wire_size - pos) {
+        count = wire_size - pos;
+    }
+    int channel = pos % 3;
+    const uint8_t *entry = &palette[pixels[pos / 3] * 3];
+    for (size_t i = 0; i < count; i++) {
+        uint8_t value = led_encoder->channel_lut[channel][entry[channel]];
+        memcpy(&symbols[i * 8], led_encoder->byte_symbols[value], sizeof(led_encoder->byte_symbols[0]));
+        if (channel == 2) {
+            channel = 0;
+            if (pos + i + 1 < wire_size) {
+                entry = &palette[pixels[(pos + i + 1) / 3] * 3];
+            }
+        }
+        else {
+            channel++;
+        }
+    }
+    return count * 8;
+}
+#endif
+
 static size_t rmt_encode_led_strip(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
 {
     rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
@@ -25,6 +156,9 @@ static size_t rmt_encode_led_strip(rmt_encoder_t *encoder, rmt_channel_handle_t
     rmt_encode_state_t session_state = RMT_ENCODING_RESET;
     rmt_encode_state_t state = RMT_ENCODING_RESET;
     size_t encoded_symbols = 0;
+    if (led_encoder->lut_encoder) {
+        return led_encoder->lut_encoder->encode(led_encoder->lut_encoder, channel, primary_data, data_size, ret_state);
+    }
     switch (led_encoder->state) {
     case 0: // send RGB data
         encoded_symbols += bytes_encoder->encode(bytes_encoder, channel, primary_data, data_size, &session_state);
@@ -56,8 +190,12 @@ out:
 static esp_err_t rmt_del_led_strip_encoder(rmt_encoder_t *encoder)
 {
     rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+    if (led_encoder->lut_encoder) {
+        rmt_del_encoder(led_encoder->lut_encoder);
+    }
     rmt_del_encoder(led_encoder->bytes_encoder);
     rmt_del_encoder(led_encoder->copy_encoder);
+    release_byte_symbols(led_encoder->byte_symbols);
     free(led_encoder);
     return ESP_OK;
 }
@@ -65,6 +203,9 @@ static esp_err_t rmt_del_led_strip_encoder(rmt_encoder_t *encoder)
 static esp_err_t rmt_led_strip_encoder_reset(rmt_encoder_t *encoder)
 {
     rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+    if (led_encoder->lut_encoder) {
+        rmt_encoder_reset(led_encoder->lut_encoder);
+    }
     rmt_encoder_reset(led_encoder->bytes_encoder);
     rmt_encoder_reset(led_encoder->copy_encoder);
     led_encoder->state = RMT_ENCODING_RESET;
@@ -76,6 +217,7 @@ esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rm
     esp_err_t ret = ESP_OK;
     rmt_led_strip_encoder_t *led_encoder = NULL;
     ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(!config->palette || config->use_lut, ESP_ERR_INVALID_ARG, err, TAG, "palette mode needs use_lut");
     led_encoder = calloc(1, sizeof(rmt_led_strip_encoder_t));
     ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
     led_encoder->base.encode = rmt_encode_led_strip;
@@ -108,16 +250,42 @@ esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rm
         .level1 = 0,
         .duration1 = reset_ticks,
     };
+
+    if (config->use_lut) {
+#ifdef LED_STRIP_ENCODER_HAS_LUT
+        led_encoder->byte_symbols = acquire_byte_symbols(bytes_encoder_config.bit0, bytes_encoder_config.bit1);
+        ESP_GOTO_ON_FALSE(led_encoder->byte_symbols, ESP_ERR_NO_MEM, err, TAG, "no mem for symbol table");
+        for (int i = 0; i < 256; i++) {
+            led_encoder->identity_lut[i] = i;
+        }
+        for (int c = 0; c < 3; c++) {
+            led_encoder->channel_lut[c] = config->channel_lut[c] ? config->channel_lut[c] : led_encoder->identity_lut;
+        }
+        led_encoder->first_pixel = config->first_pixel;
+        rmt_simple_encoder_config_t simple_encoder_config = {
+            .callback = config->palette ? rmt_encode_led_strip_palette : rmt_encode_led_strip_lut,
+            .arg = led_encoder,
+            .min_chunk_size = 8, // one byte
+        };
+        ESP_GOTO_ON_ERROR(rmt_new_simple_encoder(&simple_encoder_config, &led_encoder->lut_encoder), err, TAG, "create simple encoder failed");
+#else
+        ESP_GOTO_ON_FALSE(false, ESP_ERR_NOT_SUPPORTED, err, TAG, "LUT mode needs ESP-IDF 5.3");
+#endif
+    }
     *ret_encoder = &led_encoder->base;
     return ESP_OK;
 err:
     if (led_encoder) {
+        if (led_encoder->lut_encoder) {
+            rmt_del_encoder(led_encoder->lut_encoder);
+        }
         if (led_encoder->bytes_encoder) {
             rmt_del_encoder(led_encoder->bytes_encoder);
         }
         if (led_encoder->copy_encoder) {
             rmt_del_encoder(led_encoder->copy_encoder);
         }
+        release_byte_symbols(led_encoder->byte_symbols);
         free(led_encoder);
     }
     return ret;
@@ -6,8 +6,15 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "esp_idf_version.h"
 #include "driver/rmt_encoder.h"
 
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+// lookup table mode needs rmt_new_simple_encoder()
+#define LED_STRIP_ENCODER_HAS_LUT 1
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -17,8 +24,22 @@ extern "C" {
  */
 typedef struct {
     uint32_t resolution; /*!< Encoder resolution, in Hz */
+    bool use_lut;        /*!< Expand each byte through a prebuilt table of 8 RMT symbols
+                              instead of the generic bytes encoder (needs LED_STRIP_ENCODER_HAS_LUT) */
+    const uint8_t *channel_lut[3]; /*!< LUT mode only: optional 256 entry brightness/gamma table per
+                                        channel, in wire order (G, R, B), applied while encoding.
+                                        NULL leaves the channel as is. The tables are used in place,
+                                        so they can be updated between frames */
+    bool palette;        /*!< LUT mode only: the data of each transmit is a 256 entry GRB palette
+                              (LED_STRIP_PALETTE_BYTES) followed by one palette index per pixel,
+                              expanded to GRB while encoding */
+    uint32_t first_pixel; /*!< Palette mode only: pixels to skip after the palette, so strips on
+                               several channels can each send their run of one shared buffer.
+                               The transmit size then ends at the last pixel of the run */
 } led_strip_encoder_config_t;
 
+#define LED_STRIP_PALETTE_BYTES (256 * 3)
+
 /**
  * @brief Create RMT encoder for encoding LED strip pixels into RMT symbols
  *
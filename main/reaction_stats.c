@@ -0,0 +1,184 @@
+/* reaction_stats.c - reaction time histograms, see reaction_stats.h
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "reaction_stats.h"
+
+static const char *TAG = "reaction";
+
+static const char *split_names[REACTION_SPLITS] = { "all", "0", "90", "180", "270" };
+
+reaction_stats_t reaction_session;
+reaction_stats_t reaction_lifetime;
+
+static uint32_t bucket_of(int64_t us)
+{
+    if (us < REACTION_MIN_US) {
+        return 0;
+    }
+    if (us >= REACTION_MAX_US) {
+        return REACTION_BUCKETS - 1;
+    }
+    uint32_t v = (uint32_t) us;
+    uint32_t e = 31 - __builtin_clz(v);
+    uint32_t sub = (v >> (e - REACTION_SUB_BITS)) & ((1 << REACTION_SUB_BITS) - 1);
+    return 1 + ((e - REACTION_MIN_SHIFT) << REACTION_SUB_BITS) + sub;
+}
+
+// bucket i covers [bucket_low(i), bucket_low(i) + bucket_width(i))
+static int64_t bucket_low(uint32_t i)
+{
+    if (i == 0) {
+        return 0;
+    }
+    uint32_t e = REACTION_MIN_SHIFT + ((i - 1) >> REACTION_SUB_BITS);
+    uint32_t sub = (i - 1) & ((1 << REACTION_SUB_BITS) - 1);
+    return (int64_t) ((1 << REACTION_SUB_BITS) + sub) << (e - REACTION_SUB_BITS);
+}
+
+static int64_t bucket_width(uint32_t i)
+{
+    if (i == 0) {
+        return REACTION_MIN_US;
+    }
+    uint32_t e = REACTION_MIN_SHIFT + ((i - 1) >> REACTION_SUB_BITS);
+    return (int64_t) 1 << (e - REACTION_SUB_BITS);
+}
+
+static void hist_add(reaction_hist_t *hist, int64_t reaction_us, bool correct)
+{
+    if (!correct) {
+        hist->wrong++;
+        return;
+    }
+    if (hist->count == 0 || reaction_us < hist->min_us) {
+        hist->min_us = reaction_us;
+    }
+    if (hist->count == 0 || reaction_us > hist->max_us) {
+        hist->max_us = reaction_us;
+    }
+    hist->count++;
+    hist->sum_us += reaction_us;
+    hist->sum_sq_us += (uint64_t) (reaction_us * reaction_us);
+    hist->buckets[bucket_of(reaction_us)]++;
+}
+
+void reaction_stats_session_start(void)
+{
+    memset(&reaction_session, 0, sizeof(reaction_session));
+}
+
+void reaction_stats_add(uint16_t angle, int64_t reaction_us, bool correct)
+{
+    uint32_t split = REACTION_ANGLE_0 + (angle / 90) % 4;
+    hist_add(&reaction_session.split[REACTION_ALL], reaction_us, correct);
+    hist_add(&reaction_session.split[split], reaction_us, correct);
+    hist_add(&reaction_lifetime.split[REACTION_ALL], reaction_us, correct);
+    hist_add(&reaction_lifetime.split[split], reaction_us, correct);
+}
+
+static uint64_t isqrt64(uint64_t v)
+{
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t) 1 << 62;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// sample standard deviation from the sums, for the log only
+static int64_t stddev_us(const reaction_hist_t *hist)
+{
+    if (hist->count < 2) {
+        return 0;
+    }
+    // sum of squared differences from the mean, sum_sq - sum^2 / n, with
+    // sum = n * mean + r so that nothing on the way overflows
+    uint64_t n = hist->count;
+    int64_t mean = hist->sum_us / (int64_t) n;
+    int64_t r = hist->sum_us % (int64_t) n;
+    int64_t m2 = (int64_t) (hist->sum_sq_us - n * (uint64_t) (mean * mean)) - 2 * mean * r - r * r / (int64_t) n;
+    if (m2 <= 0) {
+        return 0;
+    }
+    return isqrt64((uint64_t) m2 / (n - 1));
+}
+
+int64_t reaction_percentile_us(const reaction_hist_t *hist, uint32_t pct)
+{
+    if (hist->count == 0) {
+        return 0;
+    }
+    // nearest rank
+    uint32_t rank = (uint32_t) (((uint64_t) hist->count * pct + 99) / 100);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint32_t seen = 0;
+    uint32_t i = 0;
+    for (; i < REACTION_BUCKETS - 1; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            break;
+        }
+    }
+    // middle of the bucket, but never outside what was actually seen
+    int64_t us = bucket_low(i) + bucket_width(i) / 2;
+    if (us < hist->min_us) {
+        us = hist->min_us;
+    }
+    if (us > hist->max_us) {
+        us = hist->max_us;
+    }
+    return us;
+}
+
+void reaction_stats_log(const char *name, const reaction_stats_t *stats)
+{
+    for (int s = 0; s < REACTION_SPLITS; s++) {
+        const reaction_hist_t *hist = &stats->split[s];
+        if (hist->count == 0) {
+            if (hist->wrong > 0) {
+                ESP_LOGI(TAG, "%s %s: 0 correct, %d wrong", name, split_names[s], (int) hist->wrong);
+            }
+            continue;
+        }
+        ESP_LOGI(TAG, "%s %s: %d correct, %d wrong, mean %d us, sd %d us, "
+                 "min %d, p50 %d, p90 %d, p99 %d, max %d us",
+                 name, split_names[s], (int) hist->count, (int) hist->wrong,
+                 (int) (hist->sum_us / hist->count), (int) stddev_us(hist), (int) hist->min_us,
+                 (int) reaction_percentile_us(hist, 50), (int) reaction_percentile_us(hist, 90),
+                 (int) reaction_percentile_us(hist, 99), (int) hist->max_us);
+    }
+
+    // the whole distribution as "<bucket low us>:<count>" pairs
+    const reaction_hist_t *all = &stats->split[REACTION_ALL];
+    char line[256];
+    size_t len = 0;
+    for (uint32_t i = 0; i < REACTION_BUCKETS; i++) {
+        if (all->buckets[i] == 0) {
+            continue;
+        }
+        if (len > sizeof(line) - 24) {
+            ESP_LOGI(TAG, "%s buckets%s", name, line);
+            len = 0;
+        }
+        len += snprintf(&line[len], sizeof(line) - len, " %d:%d",
+                        (int) bucket_low(i), (int) all->buckets[i]);
+    }
+    if (len > 0) {
+        ESP_LOGI(TAG, "%s buckets%s", name, line);
+    }
+}
@@ -0,0 +1,62 @@
+/* reaction_stats.h - reaction time histograms, per session and since boot
+ *
+ * Every answer is added to two reaction_stats_t, the current session and
+ * the lifetime one, each split by arrow angle plus an "all" split. A split
+ * keeps integer sums (count, sum and sum of squares in us) and a log
+ * bucketed histogram of the correct answers, so memory stays constant
+ * however long the game runs, adding an answer needs no float, and
+ * percentiles come out within one bucket (1/8 of an octave, about 9%) of
+ * the real value. Mean and standard deviation are only worked out for
+ * the log.
+ *
+ * Buckets: 0 holds everything below REACTION_MIN_US, then 8 per power
+ * of two up to REACTION_MAX_US, the last one also takes anything slower.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define REACTION_SUB_BITS       3
+#define REACTION_MIN_SHIFT      10      // 1.024 ms
+#define REACTION_MAX_SHIFT      24      // 16.8 s
+#define REACTION_MIN_US         (1 << REACTION_MIN_SHIFT)
+#define REACTION_MAX_US         (1 << REACTION_MAX_SHIFT)
+#define REACTION_BUCKETS        (1 + ((REACTION_MAX_SHIFT - REACTION_MIN_SHIFT) << REACTION_SUB_BITS))
+
+enum {
+    REACTION_ALL,
+    REACTION_ANGLE_0,
+    REACTION_ANGLE_90,
+    REACTION_ANGLE_180,
+    REACTION_ANGLE_270,
+    REACTION_SPLITS,
+};
+
+typedef struct {
+    uint32_t count;         // correct answers, the ones in the histogram
+    uint32_t wrong;
+    int64_t min_us;
+    int64_t max_us;
+    int64_t sum_us;
+    uint64_t sum_sq_us;     // us^2, good for ~10^8 answers at 300 ms
+    uint32_t buckets[REACTION_BUCKETS];
+} reaction_hist_t;
+
+typedef struct {
+    reaction_hist_t split[REACTION_SPLITS];
+} reaction_stats_t;
+
+extern reaction_stats_t reaction_session;
+extern reaction_stats_t reaction_lifetime;
+
+// clear the session stats, the lifetime ones keep going
+void reaction_stats_session_start(void);
+// one answer to an arrow at angle, reaction_us from the arrow lighting up
+void reaction_stats_add(uint16_t angle, int64_t reaction_us, bool correct);
+
+// pct (0-100) percentile of the correct answers, 0 if there are none
+int64_t reaction_percentile_us(const reaction_hist_t *hist, uint32_t pct);
+
+// summary line per split and the non empty buckets, to the serial console
+void reaction_stats_log(const char *name, const reaction_stats_t *stats);
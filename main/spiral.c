@@ -0,0 +1,192 @@
+/* spiral.c - the progress spiral
+ *
+ * The spiral only grows during a round, so draw_spiral() keeps a cursor and
+ * only paints the pixels lit since the last call into LAYER_SPIRAL, from a
+ * color ramp built once by setup_spiral(). Whatever is drawn over it lives
+ * in other layers, so the spiral never needs repainting.
+ *
+ * The ramp comes round every SPIRAL_RAMP positions. spiral_rotate() shifts
+ * it along the spiral: with an indexed framebuffer the ramp lives in the
+ * palette and rotating is just rewriting those entries, otherwise every
+ * drawn pixel gets repainted.
+ */
+#include "framebuffer.h"
+#include "compositor.h"
+#include "spiral.h"
+#include "evlog.h"
+
+/**
+ * @brief Simple helper function, converting HSV color space to RGB color space
+ *
+ * Wiki: https://en.wikipedia.org/wiki/HSL_and_HSV
+ *
+ */
+void hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint32_t *r, uint32_t *g, uint32_t *b)
+{
+    h %= 360; // h -> [0,360]
+    uint32_t rgb_max = v * 2.55f;
+    uint32_t rgb_min = rgb_max * (100 - s) / 100.0f;
+
+    uint32_t i = h / 60;
+    uint32_t diff = h % 60;
+
+    // RGB adjustment amount by hue
+    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
+
+    switch (i) {
+    case 0:
+        *r = rgb_max;
+        *g = rgb_min + rgb_adj;
+        *b = rgb_min;
+        break;
+    case 1:
+        *r = rgb_max - rgb_adj;
+        *g = rgb_max;
+        *b = rgb_min;
+        break;
+    case 2:
+        *r = rgb_min;
+        *g = rgb_max;
+        *b = rgb_min + rgb_adj;
+        break;
+    case 3:
+        *r = rgb_min;
+        *g = rgb_max - rgb_adj;
+        *b = rgb_max;
+        break;
+    case 4:
+        *r = rgb_min + rgb_adj;
+        *g = rgb_min;
+        *b = rgb_max;
+        break;
+    default:
+        *r = rgb_max;
+        *g = rgb_min;
+        *b = rgb_max - rgb_adj;
+        break;
+    }
+}
+
+
+static uint16_t spiral_to_strip[STRIP_LENGTH];
+// setup spiral_to_strip map array.
+// anti-clockwise spiral from 0,0 to led strip #: along the bottom, up the
+// right, back along the top and down the left, then the same one ring in,
+// for any width and height
+static void setup_spiral_to_strip()
+{
+    int xmax = SIZE_X - 1;
+    int ymax = SIZE_Y - 1;
+    int xmin = 0;
+    int ymin = 0;
+    int x;
+    int y;
+
+    int i = 0;
+    while (i < STRIP_LENGTH) {
+        for (x = xmin; x <= xmax && i < STRIP_LENGTH; x++) {
+            spiral_to_strip[i++] = xy_to_strip(x, ymin);
+        }
+        ymin += 1;
+        for (y = ymin; y <= ymax && i < STRIP_LENGTH; y++) {
+            spiral_to_strip[i++] = xy_to_strip(xmax, y);
+        }
+        xmax -= 1;
+        for (x = xmax; x >= xmin && ymin <= ymax && i < STRIP_LENGTH; x--) {
+            spiral_to_strip[i++] = xy_to_strip(x, ymax);
+        }
+        ymax -= 1;
+        for (y = ymax; y >= ymin && xmin <= xmax && i < STRIP_LENGTH; y--) {
+            spiral_to_strip[i++] = xy_to_strip(xmin, y);
+        }
+        xmin += 1;
+    }
+}
+
+// GRB color of ramp step i, spiral position p uses step p % SPIRAL_RAMP
+static uint8_t spiral_ramp[SPIRAL_RAMP * 3];
+// spiral positions [0, spiral_drawn) are already in the layer
+static uint16_t spiral_drawn = 0;
+// ramp steps the colors have been moved back by
+static uint16_t spiral_offset = 0;
+
+#if FRAMEBUFFER_INDEXED
+// ramp step i sits in palette entry SPIRAL_PALETTE + i
+#define SPIRAL_PALETTE PALETTE_FIXED
+
+static void load_ramp(void)
+{
+    for (int i = 0; i < SPIRAL_RAMP; i++) {
+        palette_set_grb(SPIRAL_PALETTE + i, &spiral_ramp[((i + spiral_offset) % SPIRAL_RAMP) * 3]);
+    }
+}
+#endif
+
+void setup_spiral()
+{
+    setup_spiral_to_strip();
+
+    uint32_t red = 0;
+    uint32_t green = 0;
+    uint32_t blue = 0;
+    uint16_t hue = 0;
+    for (int i = 0; i < SPIRAL_RAMP; i++) {
+        hue = (hue + 2) % 360;
+        hsv2rgb(359 - hue, 100, 1, &red, &green, &blue);
+        spiral_ramp[i * 3 + 0] = green;
+        spiral_ramp[i * 3 + 1] = red;
+        spiral_ramp[i * 3 + 2] = blue;
+    }
+#if FRAMEBUFFER_INDEXED
+    load_ramp();
+#endif
+    spiral_reset();
+}
+
+static inline void paint(uint16_t i)
+{
+#if FRAMEBUFFER_INDEXED
+    layer_set_color(LAYER_SPIRAL, spiral_to_strip[i], SPIRAL_PALETTE + i % SPIRAL_RAMP);
+#else
+    layer_set_grb(LAYER_SPIRAL, spiral_to_strip[i], &spiral_ramp[((i + spiral_offset) % SPIRAL_RAMP) * 3]);
+#endif
+}
+
+void spiral_reset()
+{
+    layer_clear(LAYER_SPIRAL);
+    spiral_drawn = 0;
+    spiral_rotate(SPIRAL_RAMP - spiral_offset);
+}
+
+void spiral_rotate(uint16_t steps)
+{
+    steps %= SPIRAL_RAMP;
+    if (steps == 0) {
+        return;
+    }
+    spiral_offset = (spiral_offset + steps) % SPIRAL_RAMP;
+#if FRAMEBUFFER_INDEXED
+    load_ramp();
+#else
+    for (int i = 0; i < spiral_drawn; i++) {
+        paint(i);
+    }
+#endif
+}
+
+void draw_spiral(uint16_t index) {
+    if (index >= STRIP_LENGTH) {
+        evlog(EV_SPIRAL_CLAMP, index, STRIP_LENGTH - 1, 0);
+        index = STRIP_LENGTH -1;
+    }
+    // a shorter spiral than last time, take the extra back off
+    for (int i = index; i < spiral_drawn; i++) {
+        layer_clear_pixel(LAYER_SPIRAL, spiral_to_strip[i]);
+    }
+    // append the newly lit pixels
+    for (int i = spiral_drawn; i < index; i++) {
+        paint(i);
+    }
+    spiral_drawn = index;
+}
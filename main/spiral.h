@@ -0,0 +1,22 @@
+/* spiral.h - the progress spiral, drawn incrementally into LAYER_SPIRAL
+ */
+#pragma once
+
+#include <stdint.h>
+
+// spiral positions before the color ramp repeats
+#define SPIRAL_RAMP 180
+
+// HSV -> RGB, h in degrees, s and v in percent
+void hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint32_t *r, uint32_t *g, uint32_t *b);
+
+// build the spiral order and color ramp, call after framebuffer_setup()
+// and compositor_setup()
+void setup_spiral();
+// light spiral positions [0, index) in LAYER_SPIRAL, anti-clockwise from 0,0
+void draw_spiral(uint16_t index);
+// take the whole spiral off
+void spiral_reset();
+// move the colors steps ramp positions back along the spiral, the pixels
+// lit stay the same
+void spiral_rotate(uint16_t steps);
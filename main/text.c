@@ -0,0 +1,194 @@
+/* text.c - text rasterizer and marquees, see text.h
+ */
+#include <string.h>
+#include "text.h"
+#include "digits_4x6.h"
+#include "digits_5x6.h"
+#include "letters_4x6.h"
+
+_Static_assert(DIGITS_4X6_HEIGHT == TEXT_HEIGHT && DIGITS_5X6_HEIGHT == TEXT_HEIGHT &&
+               LETTERS_4X6_HEIGHT == TEXT_HEIGHT, "the fonts have to line up");
+_Static_assert(LETTERS_4X6_Z - LETTERS_4X6_A == 25, "letters_4x6.txt starts with A..Z");
+
+// a space is this many blank columns, plus the one between glyphs
+#define SPACE_COLUMNS 2
+
+// column words and width of the glyph for c, NULL for a space
+static const uint16_t *glyph_for(char c, text_font_t font, int *width)
+{
+    if (c >= '0' && c <= '9') {
+        if (font == TEXT_FONT_5X6) {
+            *width = DIGITS_5X6_WIDTH;
+            return digits_5x6[c - '0'];
+        }
+        *width = DIGITS_4X6_WIDTH;
+        return digits_4x6[c - '0'];
+    }
+    int glyph;
+    if (c >= 'a' && c <= 'z') {
+        c -= 'a' - 'A';
+    }
+    if (c >= 'A' && c <= 'Z') {
+        glyph = LETTERS_4X6_A + c - 'A';
+    }
+    else {
+        switch (c) {
+        case '-':
+            glyph = LETTERS_4X6_DASH;
+            break;
+        case '.':
+            glyph = LETTERS_4X6_DOT;
+            break;
+        case ':':
+            glyph = LETTERS_4X6_COLON;
+            break;
+        case '!':
+            glyph = LETTERS_4X6_BANG;
+            break;
+        case '\'':
+            glyph = LETTERS_4X6_QUOTE;
+            break;
+        case '/':
+            glyph = LETTERS_4X6_SLASH;
+            break;
+        case '%':
+            glyph = LETTERS_4X6_PERCENT;
+            break;
+        default:
+            return NULL;
+        }
+    }
+    *width = LETTERS_4X6_WIDTH;
+    return letters_4x6[glyph];
+}
+
+// lay out text, writing columns only if given
+static int layout(const char *text, text_font_t font, uint16_t *columns, int max_columns)
+{
+    int n = 0;
+    for (const char *p = text; *p; p++) {
+        if (n > 0) {
+            // one blank column between glyphs
+            if (n == max_columns) {
+                break;
+            }
+            if (columns) {
+                columns[n] = 0;
+            }
+            n++;
+        }
+        int width;
+        const uint16_t *glyph = glyph_for(*p, font, &width);
+        int first = 0;
+        int last = -1;
+        if (glyph) {
+            // proportional: only the columns between the first and last lit one
+            while (first < width && glyph[first] == 0) {
+                first++;
+            }
+            for (last = width - 1; last >= first && glyph[last] == 0; last--) {
+            }
+        }
+        if (last < first) {
+            // a space, or nothing to draw of the glyph
+            for (int i = 0; i < SPACE_COLUMNS && n < max_columns; i++) {
+                if (columns) {
+                    columns[n] = 0;
+                }
+                n++;
+            }
+            continue;
+        }
+        for (int i = first; i <= last && n < max_columns; i++) {
+            if (columns) {
+                columns[n] = glyph[i];
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+int text_width(const char *text, text_font_t font)
+{
+    return layout(text, font, NULL, TEXT_MAX_COLUMNS);
+}
+
+int text_rasterize(const char *text, text_font_t font, uint16_t *columns, int max_columns)
+{
+    return layout(text, font, columns, max_columns);
+}
+
+void marquee_init(marquee_t *m, layer_id_t layer, int x, int y, int width,
+                  uint32_t red, uint32_t green, uint32_t blue, uint32_t speed)
+{
+    memset(m, 0, sizeof(*m));
+    m->layer = layer;
+    m->x = x;
+    m->y = y;
+    m->width = width;
+    m->red = red;
+    m->green = green;
+    m->blue = blue;
+    m->speed = speed;
+    m->drawn = -1;
+}
+
+void marquee_set_text(marquee_t *m, const char *text, text_font_t font, int64_t now_us)
+{
+    int length = text_rasterize(text, font, m->columns, TEXT_MAX_COLUMNS);
+    m->start_us = now_us;
+    m->drawn = -1;
+    if (length <= m->width || m->speed == 0) {
+        // fits (or isn't meant to move): centered, blank around it
+        int left = length < m->width ? (m->width - length) / 2 : 0;
+        if (length > m->width) {
+            length = m->width;
+        }
+        memmove(&m->columns[left], m->columns, length * sizeof(m->columns[0]));
+        memset(m->columns, 0, left * sizeof(m->columns[0]));
+        memset(&m->columns[left + length], 0, (m->width - left - length) * sizeof(m->columns[0]));
+        m->length = m->width;
+        m->period = 0;
+        return;
+    }
+    // the gap, then the text's start again for the windows that wrap
+    memset(&m->columns[length], 0, MARQUEE_GAP * sizeof(m->columns[0]));
+    memcpy(&m->columns[length + MARQUEE_GAP], m->columns, m->width * sizeof(m->columns[0]));
+    m->length = length;
+    m->period = length + MARQUEE_GAP;
+}
+
+// columns scrolled by now_us, from the start
+static int64_t scrolled(const marquee_t *m, int64_t now_us)
+{
+    if (now_us <= m->start_us) {
+        return 0;
+    }
+    return (now_us - m->start_us) * m->speed / 1000000;
+}
+
+bool marquee_update(marquee_t *m, int64_t now_us)
+{
+    if (m->length == 0) {
+        // no text set yet
+        return false;
+    }
+    int window = m->period ? scrolled(m, now_us) % m->period : 0;
+    if (window == m->drawn) {
+        return false;
+    }
+    layer_blit_columns_rgb(m->layer, &m->columns[window], m->width, TEXT_HEIGHT, m->x, m->y,
+                           m->red, m->green, m->blue);
+    m->drawn = window;
+    return true;
+}
+
+int64_t marquee_next_step_us(const marquee_t *m, int64_t now_us)
+{
+    if (m->period == 0) {
+        return INT64_MAX;
+    }
+    int64_t next = scrolled(m, now_us) + 1;
+    return m->start_us + (next * 1000000 + m->speed - 1) / m->speed;
+}
@@ -0,0 +1,66 @@
+/* text.h - strings rasterized into column bitmaps, and marquees that
+ * scroll them
+ *
+ * text_rasterize() lays a string out once, proportionally, as one word per
+ * column (bit j = row j), the format layer_blit_columns_rgb() takes. Digits
+ * come from digits_4x6 or digits_5x6, everything else from letters_4x6;
+ * lower case is drawn as upper case and unknown characters as a space.
+ *
+ * A marquee keeps such a rasterized string and shows a window of it in a
+ * box of a layer. Text that fits the box is centered and stays put. Longer
+ * text scrolls right to left and loops, the window position following the
+ * clock, so the scroll speed doesn't depend on the frame rate. The string
+ * isn't laid out again while it scrolls: the buffer holds the text, a gap
+ * and the start of the text once more, so any window is one run of
+ * columns and one blit. marquee_update() only blits when the window moved.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "compositor.h"
+
+#define TEXT_HEIGHT         6
+// longest rasterized string, in columns
+#define TEXT_MAX_COLUMNS    128
+// blank columns between the end of a scrolling text and its start again
+#define MARQUEE_GAP         6
+
+typedef enum {
+    TEXT_FONT_4X6,      // digits_4x6, the reaction time digits
+    TEXT_FONT_5X6,      // digits_5x6, the score digits
+} text_font_t;
+
+// columns text takes, without drawing it
+int text_width(const char *text, text_font_t font);
+// lay text out into columns, at most max_columns of it; returns the
+// columns used
+int text_rasterize(const char *text, text_font_t font, uint16_t *columns, int max_columns);
+
+typedef struct {
+    layer_id_t layer;
+    int x;              // the box on the display, bottom left corner
+    int y;
+    int width;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint32_t speed;     // columns per second while scrolling
+    uint16_t columns[TEXT_MAX_COLUMNS + MARQUEE_GAP + SIZE_X];
+    int length;         // text columns
+    int period;         // text and gap, 0 for text that doesn't scroll
+    int64_t start_us;   // when the text's first column was at the box's left
+    int drawn;          // window start on the layer, -1 for nothing yet
+} marquee_t;
+
+// a marquee in the width columns from x, y up of layer (the box has to be
+// on the display), showing nothing yet
+void marquee_init(marquee_t *m, layer_id_t layer, int x, int y, int width,
+                  uint32_t red, uint32_t green, uint32_t blue, uint32_t speed);
+// show text from now_us, scrolling it if it doesn't fit; the box is drawn
+// by the next marquee_update()
+void marquee_set_text(marquee_t *m, const char *text, text_font_t font, int64_t now_us);
+// blit the window for now_us if it moved; true if the layer changed
+bool marquee_update(marquee_t *m, int64_t now_us);
+// when the window moves next, INT64_MAX for text that stays put
+int64_t marquee_next_step_us(const marquee_t *m, int64_t now_us);
@@ -3,317 +3,292 @@
  *
  * SPDX-License-Identifier: Unlicense OR CC0-1.0
  */
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #include "esp_log.h"
-#include "driver/rmt_tx.h"
-#include "led_strip_encoder.h"
-// for input
-#include "driver/gpio.h"
-#include "freertos/queue.h"
-#include "esp_timer.h"
-// to pick random direction
-#include "esp_random.h"
-// bitmaps!!!
+// LEDs, buttons, clock and random direction
+#include "hal.h"
+#include "framebuffer.h"
+#include "compositor.h"
+#include "spiral.h"
+#include "frame_sched.h"
+#include "reaction_stats.h"
+#include "evlog.h"
+#include "text.h"
+#include "hud.h"
+#include "anim.h"
+// bitmaps!!! (generated from assets/ by tools/glyphc.pl)
 #include "bitmaps_12x12.h"
-#include "bitmaps_5x6.h"
-#include "bitmaps_4x6.h"
-
-// LED output constants
-#define STRIP_LENGTH        256
-#define FRAME_DELAY_MS      10
-#define RMT_LED_STRIP_RESOLUTION_HZ 10000000 // 10MHz resolution, 1 tick = 0.1us (led strip needs a high resolution)
-#define RMT_LED_STRIP_GPIO_NUM      2
-
-// game input GPIOs
-#define GPIO_UP 3
-#define GPIO_DOWN 0
-#define GPIO_LEFT 10
-#define GPIO_RIGHT 1
-static const char *TAG = "timesup";
-
-static uint8_t led_strip_pixels[STRIP_LENGTH * 3];
+#include "digits_5x6.h"
+#include "digits_4x6.h"
 
-/**
- * @brief Simple helper function, converting HSV color space to RGB color space
- *
- * Wiki: https://en.wikipedia.org/wiki/HSL_and_HSV
- *
- */
-void hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint32_t *r, uint32_t *g, uint32_t *b)
-{
-    h %= 360; // h -> [0,360]
-    uint32_t rgb_max = v * 2.55f;
-    uint32_t rgb_min = rgb_max * (100 - s) / 100.0f;
-
-    uint32_t i = h / 60;
-    uint32_t diff = h % 60;
-
-    // RGB adjustment amount by hue
-    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
-
-    switch (i) {
-    case 0:
-        *r = rgb_max;
-        *g = rgb_min + rgb_adj;
-        *b = rgb_min;
-        break;
-    case 1:
-        *r = rgb_max - rgb_adj;
-        *g = rgb_max;
-        *b = rgb_min;
-        break;
-    case 2:
-        *r = rgb_min;
-        *g = rgb_max;
-        *b = rgb_min + rgb_adj;
-        break;
-    case 3:
-        *r = rgb_min;
-        *g = rgb_max - rgb_adj;
-        *b = rgb_max;
-        break;
-    case 4:
-        *r = rgb_min + rgb_adj;
-        *g = rgb_min;
-        *b = rgb_max;
-        break;
-    default:
-        *r = rgb_max;
-        *g = rgb_min;
-        *b = rgb_max - rgb_adj;
-        break;
-    }
-}
+#define TARGET_FPS          60
 
+static const char *TAG = "timesup";
 
-// map x, y to led strip #
-// Assumes serpentine starting top left going down/up/down/up...
-// x/y start from 0,0 at bottom left
-#define SIZE_X 16
-#define SIZE_Y 16
-uint32_t xy_to_strip(uint32_t x, uint32_t y) 
-{
-    // flip top to bottom
-    y = SIZE_Y - 1 - y;
-    // if it's an even row
-    if ((x & 1) == 0) {
-        return x * SIZE_Y + SIZE_Y - 1 - y;
-    }
-    else {
-        return x * SIZE_Y + y;
+// draw a bitmap of given size, offset by given amount. 
+// bitmap is one word per row, leftmost pixel in bit size_x-1; only the set
+// bits are visited, lowest first
+void draw_bitmap_size_offset_xy_rgb(const uint16_t *bitmap, 
+  short int size_x, short int size_y,
+  short int offset_x, short int offset_y, 
+  short int r, short int g, short int b) {
+  for (int j = 0; j < size_y; j++) {
+    uint32_t bits = bitmap[j];
+    while (bits) {
+      int bit = __builtin_ctz(bits);
+      bits &= bits - 1;
+      set_xy_rgb(size_x - 1 - bit + offset_x, j + offset_y, r, g, b);
     }
+  } 
 }
 
+// the HUD is laid out for a 16x16 box, kept in the middle of the display
+#define HUD_X ((SIZE_X - 16) / 2)
+#define HUD_Y ((SIZE_Y - 16) / 2)
 
-static short int spiral_to_strip[SIZE_X * SIZE_Y];
-// setup spiral_to_strip map array. 
-// anti-clockwise spiral from 0,0 to led strip #
-void setup_spiral_to_strip()
-{   
-    int xmax = SIZE_X - 1;
-    int ymax = SIZE_Y - 1;
-    int xmin = 0;
-    int ymin = 0;
-    int x = 0;
-    int y = 0;
-
-    int i = 0;
-    while (i < SIZE_X * SIZE_Y) {
-        for (x = xmin; x <= xmax; x++) {
-          spiral_to_strip[i] = xy_to_strip(x,y);
-//          printf("%d = (%d, %d)\n", i, x, y);
-          if (i++ == SIZE_X * SIZE_Y) {
-            return;
-          }
-        }
-        x--;
-        ymin += 1;
-        for (y = ymin; y <= ymax; y++) {
-          spiral_to_strip[i] = xy_to_strip(x,y);
-//          printf("%d = (%d, %d)\n", i, x, y);
-          if (i++ == SIZE_X * SIZE_Y) {
-            return;
-          }
-        }
-        y--;
-        xmax -= 1;
-        for (x = xmax; x >= xmin; x--) {
-          spiral_to_strip[i] = xy_to_strip(x,y);
-//          printf("%d = (%d, %d)\n", i, x, y);
-          if (i++ == SIZE_X * SIZE_Y) {
-            return;
-          }
-        }
-        x++;
-        ymax -= 1;
-        for (y = ymax; y >= ymin; y--) {
-          spiral_to_strip[i] = xy_to_strip(x,y);
-//          printf("%d = (%d, %d)\n", i, x, y);
-          if (i++ == SIZE_X * SIZE_Y) {
-            return;
-          }
-        }
-        y++;
-        xmin += 1;
-    }
-}
+// score on top, reaction time (ms) under it, hundreds red, tens green and
+// ones blue
+static hud_number_t hud_score;
+static hud_number_t hud_time;
 
-void set_index_rgb(uint32_t index, uint32_t red, uint32_t green, uint32_t blue) {
-    led_strip_pixels[index * 3 + 0] = green;
-    led_strip_pixels[index * 3 + 1] = red;
-    led_strip_pixels[index * 3 + 2] = blue;
+void setup_hud() {
+  static const uint8_t score_colors[][3] = { { 2, 2, 2 } };
+  static const uint8_t time_colors[][3] = { { 0, 0, 2 }, { 0, 2, 0 }, { 2, 0, 0 } };
+  hud_number_init(&hud_score, LAYER_HUD, TEXT_FONT_5X6, HUD_X, HUD_Y + 1, 16, 2, score_colors, 1);
+  hud_number_init(&hud_time, LAYER_HUD, TEXT_FONT_4X6, HUD_X, HUD_Y + 8, 16, 3, time_colors, 3);
 }
 
-void set_xy_rgb(uint32_t x, uint32_t y, uint32_t red, uint32_t green, uint32_t blue) {
-    set_index_rgb(xy_to_strip(x,y), red, green, blue);
+// blank the HUD, the numbers draw again from scratch
+void clear_hud() {
+  layer_clear(LAYER_HUD);
+  hud_number_forget(&hud_score);
+  hud_number_forget(&hud_time);
 }
 
-// draw a bitmap of given size, offset by given amount. 
-void draw_bitmap_size_offset_xy_rgb(const short int *bitmap, 
-  short int size_x, short int size_y,
-  short int offset_x, short int offset_y, 
-  short int r, short int g, short int b) {
-  for (int j = 0; j < size_y; j++) {
-    for (int i = 0; i < size_x; i++) {
-      if (bitmap[j*size_x + i] == 1) {
-        set_xy_rgb(i+offset_x, j + offset_y, r, g, b);
-      }
-    }
-  } 
+void draw_score(int s) {
+  hud_number_set(&hud_score, s < 0 ? 0 : s);
 }
 
-void draw_score(short int s) {
-  if (s > 99) {
-    s = 99;
-  }
-  if (s < 0) {
-    s = 0;
-  }
-  draw_bitmap_size_offset_xy_rgb(digits_5x6[s/10], 5, 6, 2, 1, 2, 2, 2);
-  draw_bitmap_size_offset_xy_rgb(digits_5x6[s%10], 5, 6, 8, 1, 2, 2, 2);
+
+void draw_time(int t) {
+  hud_number_set(&hud_time, t < 0 ? 0 : t);
 }
 
 
-void draw_time(short int t) {
-  if (t > 999) {
-    t = 999;
-  }
-  if (t < 0) {
-    t = 0;
-  }
-  draw_bitmap_size_offset_xy_rgb(digits_4x6[t/100],    4, 6, 1, 8, 2, 0, 0);
-  draw_bitmap_size_offset_xy_rgb(digits_4x6[t%100/10], 4, 6, 6, 8, 0, 2, 0);
-  draw_bitmap_size_offset_xy_rgb(digits_4x6[t%10],     4, 6, 11, 8, 0, 0, 2);
+// 12x12 glyphs on a 16x16 display, each glyph pixel GLYPH_SCALE square on
+// bigger ones, centered
+#define GLYPH_SCALE ((SIZE_X < SIZE_Y ? SIZE_X : SIZE_Y) / 16)
+#define OFFSET_X ((SIZE_X - BITMAPS_12X12_WIDTH * GLYPH_SCALE) / 2)
+#define OFFSET_Y ((SIZE_Y - BITMAPS_12X12_HEIGHT * GLYPH_SCALE) / 2)
+// which prebuilt variant of a 12x12 glyph to use for an angle
+// (-180 is the horizontal flip)
+static int glyph_orientation(short int angle)
+{
+    switch (angle) {
+    case 90:
+        return GLYPH_ROT_90;
+    case 180:
+        return GLYPH_ROT_180;
+    case -180:
+        return GLYPH_FLIP_H;
+    case 270:
+        return GLYPH_ROT_270;
+    default:
+        return GLYPH_ROT_0;
+    }
 }
 
+// strip indices of the lit pixels of every centered, scaled 12x12 glyph
+// variant. Resolved once by setup_glyph_strip(), so drawing a glyph is a plain
+// scatter with no coordinate math or per-angle branches.
+typedef struct {
+    uint16_t count;
+    const uint16_t *index;
+} strip_list_t;
+
+static strip_list_t glyph_strip[BITMAPS_12X12_COUNT][GLYPH_ORIENTATIONS];
+static uint16_t *glyph_strip_pool = NULL;
 
-#define OFFSET_X (SIZE_X - 12) / 2
-#define OFFSET_Y (SIZE_Y - 12) / 2
-void draw_bitmap_rgb(const short int *bitmap, short int angle, short int r, short int g, short int b)
+esp_err_t setup_glyph_strip()
 {
-    if (angle == 90) {
-        //ESP_LOGI(TAG, "draw bitmap 90");
-        for (int j = 0; j < 12; j++) {
-            for (int i = 0; i < 12; i++) {
-                // 90: (x,y) -> (y, -x)
-                if (bitmap[(11-i) * 12 + j] == 1) {
-                    set_xy_rgb(i + OFFSET_X, j + OFFSET_Y, r, g, b);
-                }
+    size_t total = 0;
+    for (int glyph = 0; glyph < BITMAPS_12X12_COUNT; glyph++) {
+        for (int o = 0; o < GLYPH_ORIENTATIONS; o++) {
+            for (int row = 0; row < BITMAPS_12X12_HEIGHT; row++) {
+                total += __builtin_popcount(bitmaps_12x12[glyph][o][row]) * GLYPH_SCALE * GLYPH_SCALE;
             }
         }
     }
-    else if (angle == 180) { 
-        //ESP_LOGI(TAG, "draw bitmap 180");
-        for (int j = 0; j < 12; j++) {
-            for (int i = 0; i < 12; i++) {
-                // 180: (x,y) -> (-x, -y)
-                if (bitmap[(11-j) * 12 + (11 - i)] == 1) {
-                    set_xy_rgb(i + OFFSET_X, j + OFFSET_Y, r, g, b);
-                }
-            }
-        }
+    glyph_strip_pool = malloc(total * sizeof(uint16_t));
+    if (glyph_strip_pool == NULL) {
+        return ESP_ERR_NO_MEM;
     }
-    else if (angle == -180) { 
-        //ESP_LOGI(TAG, "draw bitmap flipped horizontal");
-        for (int j = 0; j < 12; j++) {
-            for (int i = 0; i < 12; i++) {
-                // 180: (x,y) -> (-x, -y)
-                if (bitmap[j * 12 + (11 - i)] == 1) {
-                    set_xy_rgb(i + OFFSET_X, j + OFFSET_Y, r, g, b);
+
+    uint16_t *next = glyph_strip_pool;
+    for (int glyph = 0; glyph < BITMAPS_12X12_COUNT; glyph++) {
+        for (int o = 0; o < GLYPH_ORIENTATIONS; o++) {
+            strip_list_t *list = &glyph_strip[glyph][o];
+            list->index = next;
+            for (int row = 0; row < BITMAPS_12X12_HEIGHT; row++) {
+                uint32_t bits = bitmaps_12x12[glyph][o][row];
+                while (bits) {
+                    int bit = __builtin_ctz(bits);
+                    bits &= bits - 1;
+                    uint32_t x = (BITMAPS_12X12_WIDTH - 1 - bit) * GLYPH_SCALE + OFFSET_X;
+                    uint32_t y = row * GLYPH_SCALE + OFFSET_Y;
+                    for (int dx = 0; dx < GLYPH_SCALE; dx++) {
+                        for (int dy = 0; dy < GLYPH_SCALE; dy++) {
+                            *next++ = xy_to_strip(x + dx, y + dy);
+                        }
+                    }
                 }
             }
+            list->count = next - list->index;
         }
     }
-    else if (angle == 270) {
-        //ESP_LOGI(TAG, "draw bitmap 270");
-        for (int j = 0; j < 12; j++) {
-            for (int i = 0; i < 12; i++) {
-                // 270: (x,y) -> (-y, x)
-                if (bitmap[i * 12 + 11 - j] == 1) {
-                    set_xy_rgb(i + OFFSET_X, j + OFFSET_Y, r, g, b);
-                }
-            }
-        }
+    ESP_LOGI(TAG, "glyph strip lists: %d pixels", (int) total);
+    return ESP_OK;
+}
+
+// glyph (BITMAPS_12X12_COUNT for none) and angle currently in LAYER_GLYPH
+static uint16_t glyph_on_strip = BITMAPS_12X12_COUNT;
+static short int glyph_angle_on_strip = 0;
+
+// how long the check/X stays up, and the final score
+#define FEEDBACK_US     1000000
+#define TIMES_UP_US     3000000
+
+// the check/X after an answer: pops in and fades out, the X shakes its
+// head. The arrow itself always snaps, its first frame is when the
+// reaction time starts.
+static anim_t feedback_anim;
+static anim_sprite_t feedback_sprite;
+static bool feedback_running = false;
+static uint8_t feedback_rgb[3];
+
+static void stop_feedback() {
+    if (feedback_running) {
+        feedback_running = false;
+        anim_sprite_forget(&feedback_sprite);
     }
-    else {
-        //ESP_LOGI(TAG, "draw bitmap 0");
-        for (int j = 0; j < 12; j++) {
-            for (int i = 0; i < 12; i++) {
-                if (bitmap[j * 12 + i] == 1) {
-                    set_xy_rgb(i + OFFSET_X, j + OFFSET_Y, r, g, b);
-                }
-            }
-        }
+}
+
+// put one of the bitmaps_12x12 glyphs in the center, rotated by angle, in
+// place of whatever glyph was there
+void draw_bitmap_rgb(uint16_t glyph, short int angle, short int r, short int g, short int b)
+{
+    const strip_list_t *list = &glyph_strip[glyph][glyph_orientation(angle)];
+    stop_feedback();
+    layer_clear(LAYER_GLYPH);
+    for (int k = 0; k < list->count; k++) {
+        layer_set_rgb(LAYER_GLYPH, list->index[k], r, g, b);
     }
+    glyph_on_strip = glyph;
+    glyph_angle_on_strip = angle;
 }
 
-void draw_bitmap(const short int *bitmap, short int angle) {
-    draw_bitmap_rgb(bitmap, angle, 1,1,1);
+void draw_bitmap(uint16_t glyph, short int angle) {
+    draw_bitmap_rgb(glyph, angle, 1,1,1);
 }
 
-void draw_spiral(uint16_t index) {
-    uint32_t red = 0;
-    uint32_t green = 0;
-    uint32_t blue = 0;
-    uint16_t hue = 0;
-    if (index >= STRIP_LENGTH) {
-        ESP_LOGI(TAG, "spiral index %d set to %d", index, STRIP_LENGTH - 1);
-        index = STRIP_LENGTH -1;
-    }
-    for (int i = 0; i<index; i++) {
-        // Build RGB pixels
-        hue = (hue + 2) % 360;
-        hsv2rgb(359 - hue, 100, 1, &red, &green, &blue);
-        set_index_rgb(spiral_to_strip[i], red, green, blue);
+static void clear_glyph() {
+    stop_feedback();
+    layer_clear(LAYER_GLYPH);
+    glyph_on_strip = BITMAPS_12X12_COUNT;
+}
+
+static void start_feedback(uint16_t glyph, uint8_t r, uint8_t g, uint8_t b, int64_t now) {
+    clear_glyph();
+    anim_clear(&feedback_anim);
+    anim_key(&feedback_anim, ANIM_SCALE, 0, ANIM_ONE / 2, ANIM_EASE_LINEAR);
+    anim_key(&feedback_anim, ANIM_SCALE, 250, ANIM_ONE, ANIM_EASE_OUT_BACK);
+    if (glyph == BITMAPS_12X12_X) {
+        anim_key(&feedback_anim, ANIM_ANGLE, 250, 0, ANIM_EASE_LINEAR);
+        anim_key(&feedback_anim, ANIM_ANGLE, 350, ANIM_DEG(20), ANIM_EASE_OUT);
+        anim_key(&feedback_anim, ANIM_ANGLE, 500, ANIM_DEG(-20), ANIM_EASE_IN_OUT);
+        anim_key(&feedback_anim, ANIM_ANGLE, 600, 0, ANIM_EASE_IN);
     }
+    anim_key(&feedback_anim, ANIM_BRIGHTNESS, 700, LAYER_OPAQUE, ANIM_EASE_LINEAR);
+    anim_key(&feedback_anim, ANIM_BRIGHTNESS, FEEDBACK_US / 1000, 0, ANIM_EASE_IN);
+    anim_start(&feedback_anim, now);
+    feedback_rgb[0] = r;
+    feedback_rgb[1] = g;
+    feedback_rgb[2] = b;
+    feedback_running = true;
+    glyph_on_strip = glyph;
+    glyph_angle_on_strip = 0;
 }
 
-// Queue for inputs
-static QueueHandle_t gpio_evt_queue = NULL;
+// the feedback's frame for now; true while it still moves
+static bool draw_feedback(int64_t now) {
+    anim_pose_t pose;
+    bool moving = anim_pose(&feedback_anim, now, &pose);
+    anim_sprite_draw(&feedback_sprite, bitmaps_12x12[glyph_on_strip][GLYPH_ROT_0],
+                     BITMAPS_12X12_WIDTH, BITMAPS_12X12_HEIGHT, &pose,
+                     feedback_rgb[0], feedback_rgb[1], feedback_rgb[2]);
+    return moving;
+}
 
-// ISR handler needs to be short and sweet
-static void IRAM_ATTR gpio_isr_handler(void* arg) {
-    uint32_t gpio_num = (uint32_t) arg;
-    xQueueSendFromISR(gpio_evt_queue, &gpio_num, NULL);
+// merge the layers and push the frame out, unless nothing changed since
+// the last one
+static void show_frame() {
+    compositor_merge();
+    if (framebuffer_dirty()) {
+        frame_sched_transmit_begin();
+        ESP_ERROR_CHECK(framebuffer_present());
+        frame_sched_transmit_end();
+    }
 }
 
+// after the score, the session's p50/p90/p99 for STATS_PAGE_US each
+#define STATS_PAGE_US   1500000
+// the last HURRY_US of a round the spiral colors spin, HURRY_STEPS ramp
+// steps per second
+#define HURRY_US        2000000
+#define HURRY_STEPS     90
+#define STATS_PAGES     3
+static const uint32_t stats_pages[STATS_PAGES] = { 50, 90, 99 };
+// a stats page: "P50" where the score goes, "234MS" scrolling under it,
+// one loop per page
+#define STATS_SCROLL    20
+static marquee_t stats_label;
+static marquee_t stats_value;
+
+typedef enum {
+    GAME_IDLE,          // score up, the next press starts a game
+    GAME_GLYPH,         // arrow up, waiting for the answer
+    GAME_FEEDBACK,      // check/X up until state_deadline, then a new arrow
+    GAME_TIMES_UP,      // final score up, input off until state_deadline
+} game_state_t;
+
 static uint16_t input_enabled = 0;
 static uint16_t last_input = 99;
-static uint64_t last_input_received = 0;
-// process events from queue
-static void gpio_task(void* arg) {
-    uint32_t gpio_num;
-    for (;;) {
-        if (xQueueReceive(gpio_evt_queue, &gpio_num, portMAX_DELAY)) {
-            if(input_enabled == 1) {
-                input_enabled = 0;
-                last_input_received = esp_timer_get_time();
-                ESP_LOGI(TAG, "received %d at %lld", (int) gpio_num, last_input_received);
-                last_input = gpio_num;
-            }
-        }
+static int64_t last_input_received = 0;
+
+// the ISR drops presses while input is off, so mashing costs nothing
+static void set_input_enabled(uint16_t enabled) {
+    input_enabled = enabled;
+    hal_input_arm(enabled == 1);
+}
+
+// hal_random(), logged so a session trace can hand the game the same
+// numbers again
+static uint32_t game_random(void) {
+    uint32_t r = hal_random();
+    evlog(EV_RANDOM, r, 0, 0);
+    return r;
+}
+
+// handle a button press (called from the hal input task)
+static void on_input(const input_event_t *event) {
+    if(input_enabled == 1) {
+        set_input_enabled(0);
+        // stamped in the ISR, not after the hop to this task
+        last_input_received = event->at_us;
+        evlog_at(event->at_us, EV_RECEIVED, event->gpio_num, 0, 0);
+        last_input = event->gpio_num;
     }
 }
 
@@ -321,208 +296,233 @@ static void gpio_task(void* arg) {
 void app_main(void)
 {
 
-    ESP_LOGI(TAG, "enable GPIO inputs");
-    // 3 = up
-    gpio_pullup_en(GPIO_UP);
-    gpio_set_direction(GPIO_UP, GPIO_MODE_INPUT);
-    gpio_set_intr_type(GPIO_UP, GPIO_INTR_NEGEDGE);
-    gpio_intr_enable(GPIO_UP);
-    // 0 = down
-    gpio_pullup_en(GPIO_DOWN);
-    gpio_set_direction(GPIO_DOWN, GPIO_MODE_INPUT);
-    gpio_set_intr_type(GPIO_DOWN, GPIO_INTR_NEGEDGE);
-    gpio_intr_enable(GPIO_DOWN);
-    // 10 = left
-    gpio_pullup_en(GPIO_LEFT);
-    gpio_set_direction(GPIO_LEFT, GPIO_MODE_INPUT);
-    gpio_set_intr_type(GPIO_LEFT, GPIO_INTR_NEGEDGE);
-    gpio_intr_enable(GPIO_LEFT);
-    // 1 = right
-    gpio_pullup_en(GPIO_RIGHT);
-    gpio_set_direction(GPIO_RIGHT, GPIO_MODE_INPUT);
-    gpio_set_intr_type(GPIO_RIGHT, GPIO_INTR_NEGEDGE);
-    gpio_intr_enable(GPIO_RIGHT);
-
-    ESP_LOGI(TAG, "add GPIO isr service");
-    //create a queue to handle gpio event from isr
-    gpio_evt_queue = xQueueCreate(10, sizeof(uint32_t));
-    //start gpio task
-    xTaskCreate(gpio_task, "gpio_task", 2048, NULL, 10, NULL);
-
-    //install gpio isr service
-    gpio_install_isr_service(0); // TODO - find out what the 0 means
-    //hook isr handler for specific gpio pins
-    gpio_isr_handler_add(GPIO_UP, gpio_isr_handler, (void*) GPIO_UP);
-    gpio_isr_handler_add(GPIO_DOWN, gpio_isr_handler, (void*) GPIO_DOWN);
-    gpio_isr_handler_add(GPIO_LEFT, gpio_isr_handler, (void*) GPIO_LEFT);
-    gpio_isr_handler_add(GPIO_RIGHT, gpio_isr_handler, (void*) GPIO_RIGHT);
-
-    ESP_LOGI(TAG, "Create RMT TX channel");
-    rmt_channel_handle_t led_chan = NULL;
-    rmt_tx_channel_config_t tx_chan_config = {
-        .clk_src = RMT_CLK_SRC_DEFAULT, // select source clock
-        .gpio_num = RMT_LED_STRIP_GPIO_NUM,
-        .mem_block_symbols = 64, // increase the block size can make the LED less flickering
-        .resolution_hz = RMT_LED_STRIP_RESOLUTION_HZ,
-        .trans_queue_depth = 4, // set the number of transactions that can be pending in the background
-    };
-    ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &led_chan));
-
-    ESP_LOGI(TAG, "Install led strip encoder");
-    rmt_encoder_handle_t led_encoder = NULL;
-    led_strip_encoder_config_t encoder_config = {
-        .resolution = RMT_LED_STRIP_RESOLUTION_HZ,
-    };
-    ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&encoder_config, &led_encoder));
-
-    ESP_LOGI(TAG, "Enable RMT TX channel");
-    ESP_ERROR_CHECK(rmt_enable(led_chan));
-
-    rmt_transmit_config_t tx_config = {
-        .loop_count = 0, // no transfer loop
+    static const uint32_t input_pins[] = { GPIO_UP, GPIO_DOWN, GPIO_LEFT, GPIO_RIGHT };
+    ESP_ERROR_CHECK(hal_input_init(input_pins, sizeof(input_pins) / sizeof(input_pins[0]), on_input));
+    const hal_led_config_t led_config = {
+        .pixels = STRIP_LENGTH,
+        .channels = LED_CHANNELS,
+        .indexed = FRAMEBUFFER_INDEXED,
     };
+    ESP_ERROR_CHECK(hal_led_init(&led_config));
+    // game events are logged through evlog, written out when nothing else runs
+    ESP_ERROR_CHECK(hal_start_background(evlog_drain));
 
+    ESP_LOGI(TAG, "Compute x/y to strip mapping");
+    framebuffer_setup();
+    compositor_setup();
     ESP_LOGI(TAG, "Compute spiral to strip mapping");
-    setup_spiral_to_strip();
-
-    // print out the left bitmap (remove later)
-    for (int j = 0; j < 12; j++) {
-        for (int i = 0; i < 12; i++) {
-            printf("%d,", bitmap_left12x12[j*(SIZE_X - OFFSET_X*2) + i]);
-        }
-    }
+    setup_spiral();
+    ESP_LOGI(TAG, "Compute glyph to strip mapping");
+    ESP_ERROR_CHECK(setup_glyph_strip());
+    anim_sprite_init(&feedback_sprite, LAYER_GLYPH, GLYPH_SCALE);
+    setup_hud();
+    marquee_init(&stats_label, LAYER_HUD, HUD_X, HUD_Y + 1, 16, 2, 2, 2, STATS_SCROLL);
+    marquee_init(&stats_value, LAYER_HUD, HUD_X, HUD_Y + 8, 16, 0, 2, 2, STATS_SCROLL);
 
     // start with a clear display
-    for (int j = 0; j< STRIP_LENGTH; j++) {
-        set_index_rgb(j,0,0,0);
-    }
-    // Flush RGB values to LEDs
-    ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-    ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+    show_frame();
 
     uint32_t time_limit = 8000000; // 8 seconds worth of micros
     uint32_t elapsed_time = 0;
     int64_t enable_start = 0;
-    int64_t delay_start = 0;
-    uint16_t glyph_displayed = 0;
+    int64_t state_deadline = INT64_MAX;
+    // the arrow's trip to the LEDs: drawn, handed to the RMT, latched
+    uint32_t glyph_frame = 0;
+    int64_t glyph_drawn_at = 0;
+    int64_t glyph_queued_at = 0;
+    int64_t glyph_lit_at = 0;
+    game_state_t state = GAME_IDLE;
+    uint16_t times_up_page = 0;
+    uint16_t hurry_steps = 0;
     uint16_t angle = 0;
-    uint16_t game_on = 0;
     uint16_t score = 0;
     int64_t min_reaction = 999;
     // enable input since using it to start game
-    input_enabled = 1;
+    set_input_enabled(1);
     ESP_LOGI(TAG, "Begin main loop");
+    frame_sched_start(TARGET_FPS);
     int64_t now = 0;
     draw_score(0);
     draw_time(999);
-    while (1) {
-        now = esp_timer_get_time();
-        // counting time and total time is > limit
-        if (game_on == 0) {
-          if (last_input == 99) {
-            vTaskDelay(pdMS_TO_TICKS(FRAME_DELAY_MS));
-          }
-          else {
-            game_on = 1;
-            last_input = 99;
-            input_enabled = 0;
-            for (int j = 0; j< STRIP_LENGTH; j++) {
-                set_index_rgb(j,0,0,0);
-            }
-            ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-            ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
-            delay_start = now;
-          }
-        }
-        else if (enable_start > 0 && now - enable_start + elapsed_time >= time_limit) {
-            ESP_LOGI(TAG, "TIME's UP!! %lld %lld, score %d", enable_start, now, score);
-            for (int j = 0; j< STRIP_LENGTH; j++) {
-                set_index_rgb(j,0,0,0);
-            }
+    while (hal_running()) {
+        now = hal_time_us();
+        // time only runs while enable_start is set
+        int64_t run_time = enable_start > 0 ? now - enable_start + elapsed_time : elapsed_time;
+        if (enable_start > 0 && run_time >= time_limit) {
+            ESP_LOGI(TAG, "TIME's UP!! %lld %lld, score %d", (long long) enable_start, (long long) now, score);
+            spiral_reset();
+            hurry_steps = 0;
+            clear_glyph();
             draw_score(score);
             draw_time(min_reaction);
-            // Flush RGB values to LEDs
-            ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-            ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
-            input_enabled = 0;
+            layer_set_visible(LAYER_HUD, true);
+            set_input_enabled(0);
             elapsed_time = 0;
             enable_start = 0;
-            vTaskDelay(pdMS_TO_TICKS(3000)); // 5 second delay
-            glyph_displayed = 0;
-            game_on = 0;
-            score = 0;
-            min_reaction = 999;
-            last_input = 99;
-            input_enabled = 1;
+            frame_sched_log();
+            reaction_stats_log("session", &reaction_session);
+            reaction_stats_log("lifetime", &reaction_lifetime);
+            state = GAME_TIMES_UP;
+            state_deadline = now + TIMES_UP_US;
+            times_up_page = 0;
         }
-        else if (glyph_displayed == 1) {
+        else switch (state) {
+        case GAME_IDLE:
+            if (last_input != 99) {
+                last_input = 99;
+                set_input_enabled(0);
+                layer_set_visible(LAYER_HUD, false);
+                reaction_stats_session_start();
+                state = GAME_FEEDBACK;
+                state_deadline = now + FEEDBACK_US;
+            }
+            break;
+        case GAME_GLYPH:
             if (last_input != 99) { // there is some input
-                // clear the bitmap part
-                for (int j = 0; j< STRIP_LENGTH; j++) {
-                    set_index_rgb(j,0,0,0);
+                if (glyph_lit_at == 0) {
+                    // pressed before the arrow was even out
+                    ESP_ERROR_CHECK(hal_led_wait_frame(glyph_frame));
+                    glyph_lit_at = hal_led_frame_done_us(glyph_frame);
+                }
+                if (last_input_received < glyph_lit_at) {
+                    // input is on while the arrow is still on the wire, a
+                    // press before it lit is a guess: drop it, no score
+                    evlog(EV_EARLY, last_input, glyph_lit_at - last_input_received, 0);
+                    last_input = 99;
+                    set_input_enabled(1);
+                    break;
                 }
-                glyph_displayed = 0;
+                // from the LEDs lighting up to the ISR seeing the press
+                int64_t reaction = last_input_received - glyph_lit_at;
                 if ((angle == 0 && last_input == GPIO_LEFT) ||
                     (angle == 90 && last_input == GPIO_UP) ||
                     (angle == 180 && last_input == GPIO_RIGHT) ||
                     (angle == 270 && last_input == GPIO_DOWN)) 
                 {
-                    ESP_LOGI(TAG, "CORRECT INPUT");
+                    evlog(EV_CORRECT, 0, 0, 0);
                     score++;
                     elapsed_time += now - enable_start;
-                    if (min_reaction > (last_input_received - enable_start)/1000) {
-                        min_reaction = (last_input_received - enable_start)/1000;
+                    run_time = elapsed_time;
+                    reaction_stats_add(angle, reaction, true);
+                    if (min_reaction > reaction/1000) {
+                        min_reaction = reaction/1000;
                     }
-                    ESP_LOGI(TAG, "reaction = %lld", last_input_received - enable_start);
+                    evlog(EV_REACTION, reaction, glyph_queued_at - glyph_drawn_at, glyph_lit_at - glyph_queued_at);
                     enable_start = 0;
-                    draw_spiral((uint16_t) ((elapsed_time) * STRIP_LENGTH / time_limit));
-                    draw_bitmap_rgb(bitmap_check12x12,0,0,2,0);
+                    start_feedback(BITMAPS_12X12_CHECK, 0, 2, 0, now);
                 }
                 else {
-                    ESP_LOGI(TAG, "WRONG INPUT");
-                    draw_spiral((uint16_t) ((now - enable_start + elapsed_time) * STRIP_LENGTH / time_limit));
-                    draw_bitmap_rgb(bitmap_x12x12,0,2,0,0);
+                    evlog(EV_WRONG, 0, 0, 0);
+                    reaction_stats_add(angle, reaction, false);
+                    start_feedback(BITMAPS_12X12_X, 2, 0, 0, now);
                 }
-                delay_start = now;
-            }
-            else {
-                draw_bitmap(bitmap_left12x12, angle);
-                draw_spiral((uint16_t) ((now - enable_start + elapsed_time) * STRIP_LENGTH / time_limit));
+                state = GAME_FEEDBACK;
+                state_deadline = now + FEEDBACK_US;
             }
-        }
-        else { // glyph not displayed (and time not up)
-            if (delay_start == 0 || now - delay_start > 1000000) {
+            break;
+        case GAME_FEEDBACK:
+            if (now >= state_deadline) {
                 // set up for next one
                 //angle = (angle + 90) % 360;
-                angle = (esp_random() & 3) * 90;
-                ESP_LOGI(TAG, "new angle = %d", angle);
+                angle = (game_random() & 3) * 90;
+                evlog(EV_NEW_ANGLE, angle, 0, 0);
                 last_input = 99;  // clear last input
-                for (int j = 0; j< STRIP_LENGTH; j++) {
-                   set_index_rgb(j,0,0,0);
-                }
                 if (enable_start == 0) { // start counting time if not already
                     enable_start = now;
-                    ESP_LOGI(TAG, "start enabled %lld", now);
+                    run_time = elapsed_time;
+                    evlog(EV_START_ENABLED, 0, 0, 0);
                 }
-                else { // time is enabled so update the spiral
-                    draw_spiral((uint16_t) ((now - enable_start + elapsed_time) * STRIP_LENGTH / time_limit));
+                state = GAME_GLYPH;
+                state_deadline = INT64_MAX;
+                glyph_frame = 0;
+                glyph_lit_at = 0;
+                set_input_enabled(1);
+            }
+            break;
+        case GAME_TIMES_UP:
+            if (now >= state_deadline) {
+                // then the session's percentiles, labelled in the score digits
+                const reaction_hist_t *hist = &reaction_session.split[REACTION_ALL];
+                if (hist->count > 0 && times_up_page < STATS_PAGES) {
+                    uint32_t pct = stats_pages[times_up_page++];
+                    char text[16];
+                    snprintf(text, sizeof(text), "P%u", (unsigned) pct);
+                    marquee_set_text(&stats_label, text, TEXT_FONT_5X6, now);
+                    snprintf(text, sizeof(text), "%uMS", (unsigned) (reaction_percentile_us(hist, pct) / 1000));
+                    marquee_set_text(&stats_value, text, TEXT_FONT_4X6, now);
+                    state_deadline = now + STATS_PAGE_US;
+                    break;
                 }
-                glyph_displayed = 1;
-                delay_start = 0;
-                input_enabled = 1;
+                if (times_up_page > 0) {
+                    // back to the score for the idle screen, over the text
+                    hud_number_forget(&hud_score);
+                    hud_number_forget(&hud_time);
+                    draw_score(score);
+                    draw_time(min_reaction);
+                }
+                score = 0;
+                min_reaction = 999;
+                last_input = 99;
+                state = GAME_IDLE;
+                state_deadline = INT64_MAX;
+                set_input_enabled(1);
             }
-            else {
-                if (enable_start == 0) {
-                    draw_spiral((uint16_t)((elapsed_time) * STRIP_LENGTH / time_limit));
-                } 
-                else {
-                    draw_spiral((uint16_t)((now - enable_start + elapsed_time) * STRIP_LENGTH / time_limit));
+            break;
+        }
+
+        int64_t wake_at = state_deadline;
+        bool glyph_drawn = false;
+        if (state == GAME_GLYPH || state == GAME_FEEDBACK) {
+            // a glyph that is already up stays, the spiral grows underneath
+            if (state == GAME_GLYPH &&
+                (glyph_on_strip != BITMAPS_12X12_LEFT || glyph_angle_on_strip != angle)) {
+                draw_bitmap(BITMAPS_12X12_LEFT, angle);
+                glyph_drawn = true;
+            }
+            if (state == GAME_FEEDBACK && feedback_running && draw_feedback(now)) {
+                // animating, every frame
+                wake_at = now;
+            }
+            uint16_t index = (uint16_t) (run_time * STRIP_LENGTH / time_limit);
+            draw_spiral(index);
+            if (enable_start > 0) {
+                // nothing changes on screen before the spiral grows again,
+                // its last step is time's up
+                int64_t step_at = enable_start - elapsed_time +
+                    ((int64_t) (index + 1) * time_limit + STRIP_LENGTH - 1) / STRIP_LENGTH;
+                if (step_at < wake_at) {
+                    wake_at = step_at;
                 }
+                int64_t hurry = run_time - (time_limit - HURRY_US);
+                if (hurry >= 0) {
+                    // spin by a palette change (or repaint), every frame
+                    uint16_t steps = hurry * HURRY_STEPS / 1000000;
+                    spiral_rotate(steps - hurry_steps);
+                    hurry_steps = steps;
+                    wake_at = now;
+                }
+            }
+        }
+        if (state == GAME_TIMES_UP && times_up_page > 0) {
+            marquee_update(&stats_label, now);
+            marquee_update(&stats_value, now);
+            int64_t step_at = marquee_next_step_us(&stats_value, now);
+            if (step_at < wake_at) {
+                wake_at = step_at;
             }
         }
         // Flush RGB values to LEDs
-        ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-        ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
-        vTaskDelay(pdMS_TO_TICKS(FRAME_DELAY_MS));
+        int64_t queued_at = hal_time_us();
+        show_frame();
+        if (glyph_drawn && glyph_frame == 0) {
+            glyph_frame = presented_frame;
+            glyph_drawn_at = now;
+            glyph_queued_at = queued_at;
+        }
+        // pick up the completion time while the hal still remembers it
+        if (glyph_frame != 0 && glyph_lit_at == 0) {
+            glyph_lit_at = hal_led_frame_done_us(glyph_frame);
+        }
+        frame_sched_wait_event(wake_at);
     }
 }
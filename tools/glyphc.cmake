@@ -0,0 +1,29 @@
+# timesup_glyph_headers(<target> <sheet>...)
+#
+# Run tools/glyphc.pl on each glyph sheet in assets/ and put the generated
+# <sheet name>.h in the target's include path. Shared by the ESP-IDF
+# component (main/) and the host build (host/).
+find_package(Perl REQUIRED)
+
+set(TIMESUP_GLYPHC ${CMAKE_CURRENT_LIST_DIR}/glyphc.pl)
+set(TIMESUP_ASSETS_DIR ${CMAKE_CURRENT_LIST_DIR}/../assets)
+
+function(timesup_glyph_headers target)
+    set(out_dir ${CMAKE_CURRENT_BINARY_DIR}/glyphs)
+    file(MAKE_DIRECTORY ${out_dir})
+    set(headers)
+    foreach(sheet ${ARGN})
+        get_filename_component(name ${sheet} NAME_WE)
+        set(header ${out_dir}/${name}.h)
+        add_custom_command(
+            OUTPUT ${header}
+            COMMAND ${PERL_EXECUTABLE} ${TIMESUP_GLYPHC} -o ${header} ${TIMESUP_ASSETS_DIR}/${sheet}
+            DEPENDS ${TIMESUP_GLYPHC} ${TIMESUP_ASSETS_DIR}/${sheet}
+            COMMENT "Compiling glyph sheet ${sheet}"
+            VERBATIM)
+        list(APPEND headers ${header})
+    endforeach()
+    add_custom_target(${target}_glyphs DEPENDS ${headers})
+    add_dependencies(${target} ${target}_glyphs)
+    target_include_directories(${target} PRIVATE ${out_dir})
+endfunction()
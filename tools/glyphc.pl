@@ -0,0 +1,232 @@
+#!/usr/bin/perl
+# glyphc.pl - compile glyph sheets into packed C tables
+#
+#   glyphc.pl -o out.h sheet.txt
+#
+# A sheet is plain text:
+#
+#   set <table> <w>x<h> [flags]    start a table of w x h glyphs
+#   glyph <name>                   followed by h rows of '#' (lit) / '.' (dark)
+#   pbm <file> <name> <name> ...   cut glyphs left to right out of a PBM
+#                                  (P1 or P4) sprite sheet, w x h per cell
+#
+# '#' starts a comment on any other line. Each glyph becomes one uint16_t
+# per row with the leftmost pixel in bit w-1, the layout the blitters in
+# timesup_main.c walk. Flags:
+#
+#   rotate    (square only) also emit the 90/180/270 and horizontally
+#             flipped variants, so drawing at an angle is a plain blit
+#   columns   emit one word per column instead, bit j = row j, for the
+#             column run blitter in framebuffer.c
+use strict;
+use warnings;
+use File::Basename;
+
+my $out;
+my @sheets;
+while (@ARGV) {
+    my $arg = shift @ARGV;
+    if ($arg eq '-o') {
+        $out = shift @ARGV;
+    } else {
+        push @sheets, $arg;
+    }
+}
+die "usage: $0 -o out.h sheet.txt ...\n" unless defined $out && @sheets;
+
+my @tables;     # { name, w, h, rotate, glyphs => [ { name, rows => [bits...] } ] }
+my $table;
+
+sub fail { my ($where, $msg) = @_; die "$where: $msg\n"; }
+
+sub add_glyph {
+    my ($where, $name, @rows) = @_;
+    fail($where, "glyph before any set") unless $table;
+    fail($where, "duplicate glyph $name") if grep { $_->{name} eq $name } @{$table->{glyphs}};
+    push @{$table->{glyphs}}, { name => $name, rows => [@rows] };
+}
+
+# read a PBM into a list of rows, each a list of 0/1
+sub read_pbm {
+    my ($path) = @_;
+    open(my $fh, '<:raw', $path) or die "$path: $!\n";
+    local $/;
+    my $data = <$fh>;
+    close($fh);
+    my @tok;
+    # header: magic, width, height, comments allowed between tokens
+    while (@tok < 3) {
+        $data =~ s/^\s+//;
+        if ($data =~ s/^#[^\n]*\n//) { next; }
+        $data =~ s/^(\S+)// or die "$path: truncated header\n";
+        push @tok, $1;
+    }
+    my ($magic, $w, $h) = @tok;
+    my @pixels;
+    if ($magic eq 'P1') {
+        $data =~ s/#[^\n]*\n//g;
+        my @bits = ($data =~ /([01])/g);
+        die "$path: short P1 data\n" if @bits < $w * $h;
+        push @pixels, [ splice(@bits, 0, $w) ] for 1 .. $h;
+    } elsif ($magic eq 'P4') {
+        $data =~ s/^\s//;
+        my $stride = int(($w + 7) / 8);
+        die "$path: short P4 data\n" if length($data) < $stride * $h;
+        for my $y (0 .. $h - 1) {
+            my @bits = split //, unpack('B*', substr($data, $y * $stride, $stride));
+            push @pixels, [ @bits[0 .. $w - 1] ];
+        }
+    } else {
+        die "$path: not a PBM (P1/P4) file\n";
+    }
+    return ($w, $h, @pixels);
+}
+
+sub row_bits {
+    my (@cells) = @_;
+    my $bits = 0;
+    $bits = ($bits << 1) | $_ for @cells;
+    return $bits;
+}
+
+for my $sheet (@sheets) {
+    open(my $fh, '<', $sheet) or die "$sheet: $!\n";
+    my @lines = <$fh>;
+    close($fh);
+    my $n = 0;
+    while ($n < @lines) {
+        my $line = $lines[$n++];
+        my $where = "$sheet:$n";
+        $line =~ s/#.*//;
+        next if $line =~ /^\s*$/;
+        my @f = split ' ', $line;
+        if ($f[0] eq 'set') {
+            my ($name, $size, @flags) = @f[1 .. $#f];
+            fail($where, "set <table> <w>x<h> [rotate] [columns]") unless $name && $size && $size =~ /^(\d+)x(\d+)$/;
+            my ($w, $h) = ($1, $2);
+            my %flag;
+            for (@flags) {
+                fail($where, "unknown flag $_") unless /^(rotate|columns)$/;
+                $flag{$_} = 1;
+            }
+            fail($where, "only square tables can rotate") if $flag{rotate} && $w != $h;
+            fail($where, "more than 16 pixels don't fit a uint16_t") if ($flag{columns} ? $h : $w) > 16;
+            $table = { name => $name, w => $w, h => $h, rotate => $flag{rotate}, columns => $flag{columns},
+                       glyphs => [], sheet => $sheet };
+            push @tables, $table;
+        } elsif ($f[0] eq 'glyph') {
+            fail($where, "glyph <name>") unless defined $f[1] && $f[1] =~ /^\w+$/;
+            fail($where, "glyph before any set") unless $table;
+            my @rows;
+            for my $y (1 .. $table->{h}) {
+                my $row = $lines[$n++];
+                fail("$sheet:$n", "glyph $f[1] is short of rows") unless defined $row;
+                $row =~ s/\s+$//;
+                fail("$sheet:$n", "expected $table->{w} of '#'/'.'") unless $row =~ /^[#.]{$table->{w}}$/;
+                push @rows, row_bits(map { $_ eq '#' ? 1 : 0 } split //, $row);
+            }
+            add_glyph($where, $f[1], @rows);
+        } elsif ($f[0] eq 'pbm') {
+            fail($where, "pbm before any set") unless $table;
+            fail($where, "pbm <file> <name> ...") unless @f >= 3;
+            my ($pw, $ph, @pixels) = read_pbm(dirname($sheet) . '/' . $f[1]);
+            my @names = @f[2 .. $#f];
+            fail($where, "$f[1] is ${pw}x$ph, need " . (@names * $table->{w}) . "x$table->{h}")
+                if $pw < @names * $table->{w} || $ph < $table->{h};
+            for my $i (0 .. $#names) {
+                my $x0 = $i * $table->{w};
+                my @rows = map { row_bits(@{$pixels[$_]}[$x0 .. $x0 + $table->{w} - 1]) } 0 .. $table->{h} - 1;
+                add_glyph($where, $names[$i], @rows);
+            }
+        } else {
+            fail($where, "unknown directive $f[0]");
+        }
+    }
+}
+
+# rotate/flip a square glyph the way draw_bitmap_rgb used to per pixel:
+# source (row, col) with col 0 leftmost lands on (i, j) = (x, y)
+sub transform {
+    my ($rows, $n, $map) = @_;
+    my @out = (0) x $n;
+    for my $row (0 .. $n - 1) {
+        for my $col (0 .. $n - 1) {
+            next unless ($rows->[$row] >> ($n - 1 - $col)) & 1;
+            my ($i, $j) = $map->($row, $col);
+            $out[$j] |= 1 << ($n - 1 - $i);
+        }
+    }
+    return @out;
+}
+
+my @orientations = (
+    [ 'ROT_0',   sub { ($_[1], $_[0]) } ],
+    [ 'ROT_90',  sub { ($_[2] - $_[0], $_[1]) } ],
+    [ 'ROT_180', sub { ($_[2] - $_[1], $_[2] - $_[0]) } ],
+    [ 'ROT_270', sub { ($_[0], $_[2] - $_[1]) } ],
+    [ 'FLIP_H',  sub { ($_[2] - $_[1], $_[0]) } ],
+);
+
+# row words -> column words, bit j of column i is row j
+sub to_columns {
+    my ($rows, $w, $h) = @_;
+    my @cols = (0) x $w;
+    for my $j (0 .. $h - 1) {
+        for my $i (0 .. $w - 1) {
+            $cols[$i] |= 1 << $j if ($rows->[$j] >> ($w - 1 - $i)) & 1;
+        }
+    }
+    return @cols;
+}
+
+sub fmt_words {
+    my ($t, $indent, @rows) = @_;
+    my ($n, @words) = ($t->{w}, @rows);
+    ($n, @words) = ($t->{h}, to_columns(\@rows, $t->{w}, $t->{h})) if $t->{columns};
+    return join('', map { sprintf("%s0b%0${n}b,\n", $indent, $_) } @words);
+}
+
+# prefixed, "LETTERS_4X6_H" would also be the name of a glyph H
+my $guard = 'GLYPHC_' . uc(basename($out));
+$guard =~ s/\W/_/g;
+open(my $oh, '>', "$out.tmp") or die "$out.tmp: $!\n";
+print $oh "// " . basename($out) . " - generated by tools/glyphc.pl from " . join(' ', map { basename($_) } @sheets) . ", do not edit\n";
+print $oh "#ifndef $guard\n#define $guard\n\n#include <stdint.h>\n";
+my $any_rotate = grep { $_->{rotate} } @tables;
+if ($any_rotate) {
+    print $oh "\n#ifndef GLYPH_ORIENTATIONS\n";
+    print $oh "// variants of a rotatable glyph, see glyph_orientation() in timesup_main.c\n";
+    print $oh "enum { " . join(', ', map { "GLYPH_$_->[0]" } @orientations) . ", GLYPH_ORIENTATIONS };\n";
+    print $oh "#endif\n";
+}
+for my $t (@tables) {
+    my $uc = uc($t->{name});
+    my ($w, $h) = ($t->{w}, $t->{h});
+    my $words = $t->{columns} ? $w : $h;
+    print $oh "\n#define ${uc}_WIDTH $w\n#define ${uc}_HEIGHT $h\n";
+    print $oh "enum {\n";
+    print $oh "    ${uc}_" . uc($_->{name}) . ",\n" for @{$t->{glyphs}};
+    print $oh "    ${uc}_COUNT\n};\n";
+    print $oh "// one word per column, bit j = row j\n" if $t->{columns};
+    if ($t->{rotate}) {
+        print $oh "static const uint16_t $t->{name}\[${uc}_COUNT][GLYPH_ORIENTATIONS][$words] __attribute__((aligned(4))) = {\n";
+        for my $g (@{$t->{glyphs}}) {
+            print $oh "    { // $g->{name}\n";
+            for my $o (@orientations) {
+                my $map = $o->[1];
+                my @rows = transform($g->{rows}, $w, sub { $map->(@_, $w - 1) });
+                print $oh "        { // $o->[0]\n" . fmt_words($t, '            ', @rows) . "        },\n";
+            }
+            print $oh "    },\n";
+        }
+    } else {
+        print $oh "static const uint16_t $t->{name}\[${uc}_COUNT][$words] __attribute__((aligned(4))) = {\n";
+        for my $g (@{$t->{glyphs}}) {
+            print $oh "    { // $g->{name}\n" . fmt_words($t, '        ', @{$g->{rows}}) . "    },\n";
+        }
+    }
+    print $oh "};\n";
+}
+print $oh "\n#endif\n";
+close($oh);
+rename("$out.tmp", $out) or die "$out: $!\n";